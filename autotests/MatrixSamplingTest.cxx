@@ -0,0 +1,115 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// CPU reference of the bilinear and bicubic interpolation of the warping vertex shader, see Matrix::sampleBilinear()
+// and Matrix::sampleBicubic().
+
+#include "TestSupport.hxx"
+#include "WarpingUtils.hxx"
+
+using Warping::Matrix;
+
+namespace
+{
+  constexpr uint32_t s_dimX = 7;
+  constexpr uint32_t s_dimY = 5;
+
+  /**
+   * @brief Curved grid with values that are exact in single precision.
+   */
+  Matrix curvedGrid()
+  {
+    Matrix matrix(s_dimX, s_dimY);
+    for (uint32_t y = 0; y < s_dimY; y++)
+    {
+      for (uint32_t x = 0; x < s_dimX; x++)
+      {
+        matrix.set(x, y, 0, 0.25 * x * x - 0.5 * y + 0.125 * x * y);
+        matrix.set(x, y, 1, -0.75 * y * y + 0.25 * x);
+      }
+    }
+    return matrix;
+  }
+
+  float64_t affineX(float64_t x, float64_t y) { return 0.5 * x - 0.25 * y + 0.125; }
+  float64_t affineY(float64_t x, float64_t y) { return -0.375 * x + 0.75 * y - 1.0; }
+
+  Matrix affineGrid()
+  {
+    Matrix matrix(s_dimX, s_dimY);
+    for (uint32_t y = 0; y < s_dimY; y++)
+    {
+      for (uint32_t x = 0; x < s_dimX; x++)
+      {
+        matrix.set(x, y, 0, affineX(x, y));
+        matrix.set(x, y, 1, affineY(x, y));
+      }
+    }
+    return matrix;
+  }
+
+  /**
+   * @brief Both interpolations go through every node, including the last row and column.
+   */
+  void testExactAtNodes()
+  {
+    const Matrix matrix = curvedGrid();
+    for (uint32_t y = 0; y < s_dimY; y++)
+    {
+      for (uint32_t x = 0; x < s_dimX; x++)
+      {
+        const std::array<float64_t, 2> bilinear = matrix.sampleBilinear(x, y);
+        const std::array<float64_t, 2> bicubic  = matrix.sampleBicubic(x, y);
+        for (uint32_t c = 0; c < 2; c++)
+        {
+          ARHUD_CHECK(bilinear[c] == matrix.get(x, y, c));
+          ARHUD_CHECK(bicubic[c] == matrix.get(x, y, c));
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Catmull-Rom splines reproduce linear data, so both interpolations agree on an affine grid wherever the 4x4
+   * neighbourhood of a cell lies within the matrix. Towards the border the neighbours are clamped and the bicubic
+   * interpolation is no longer linear.
+   */
+  void testBicubicMatchesBilinearOnAffineGrid()
+  {
+    const Matrix matrix = affineGrid();
+    for (float64_t y = 1.0; y <= s_dimY - 2.0; y += 0.125)
+    {
+      for (float64_t x = 1.0; x <= s_dimX - 2.0; x += 0.125)
+      {
+        const std::array<float64_t, 2> bilinear = matrix.sampleBilinear(x, y);
+        const std::array<float64_t, 2> bicubic  = matrix.sampleBicubic(x, y);
+        ARHUD_CHECK(TestSupport::fuzzyCompare(bilinear[0], affineX(x, y), 1.0e-9));
+        ARHUD_CHECK(TestSupport::fuzzyCompare(bilinear[1], affineY(x, y), 1.0e-9));
+        ARHUD_CHECK(TestSupport::fuzzyCompare(bicubic[0], bilinear[0], 1.0e-9));
+        ARHUD_CHECK(TestSupport::fuzzyCompare(bicubic[1], bilinear[1], 1.0e-9));
+      }
+    }
+  }
+
+  /**
+   * @brief Positions outside the matrix are clamped to its border.
+   */
+  void testClampsOutsideMatrix()
+  {
+    const Matrix matrix = curvedGrid();
+    const std::array<float64_t, 2> bilinear = matrix.sampleBilinear(-3.0, s_dimY + 2.0);
+    const std::array<float64_t, 2> bicubic  = matrix.sampleBicubic(s_dimX + 1.0, -0.5);
+    ARHUD_CHECK(bilinear[0] == matrix.get(0, s_dimY - 1, 0));
+    ARHUD_CHECK(bilinear[1] == matrix.get(0, s_dimY - 1, 1));
+    ARHUD_CHECK(bicubic[0] == matrix.get(s_dimX - 1, 0, 0));
+    ARHUD_CHECK(bicubic[1] == matrix.get(s_dimX - 1, 0, 1));
+  }
+}  // namespace
+
+int main()
+{
+  testExactAtNodes();
+  testBicubicMatchesBilinearOnAffineGrid();
+  testClampsOutsideMatrix();
+  return TestSupport::result();
+}
@@ -0,0 +1,192 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// CPU reference of the partial matrix texture uploads of MBitionWarpedOutput: uploading only Matrix::differingRegion()
+// of a recalibrated matrix, with the row length of the whole matrix, has to leave the texture as a full upload would.
+
+#include "MatrixTextureModel.hxx"
+#include "TestSupport.hxx"
+#include "WarpingUtils.hxx"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using Warping::Matrix;
+
+namespace
+{
+  constexpr uint32_t s_dimX        = 9;
+  constexpr uint32_t s_dimY        = 6;
+  constexpr uint32_t s_matrixCount = 3;
+
+  /**
+   * @brief Texture of components of type T, updated like glTexSubImage2D() with GL_UNPACK_ROW_LENGTH.
+   */
+  template<typename T>
+  struct Texture
+  {
+    uint32_t       width;
+    uint32_t       height;
+    uint32_t       components;
+    std::vector<T> texels;
+
+    Texture(uint32_t w, uint32_t h, uint32_t c) : width(w), height(h), components(c), texels(size_t{w} * h * c) { }
+
+    /**
+     * @brief Row r of the source starts rowLength texels after row r - 1, a rowLength of 0 means the region width.
+     */
+    void subImage(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t rowLength, const T* pixels)
+    {
+      const uint32_t stride = (rowLength != 0 ? rowLength : w) * components;
+      for (uint32_t row = 0; row < h; row++)
+      {
+        for (uint32_t column = 0; column < w * components; column++)
+        {
+          texels[(size_t{y + row} * width) * components + size_t{x} * components + column] = pixels[size_t{row} * stride + column];
+        }
+      }
+    }
+  };
+
+  std::shared_ptr<const Matrix> grid(float offset)
+  {
+    auto matrix = std::make_shared<Matrix>(s_dimX, s_dimY);
+    for (uint32_t y = 0; y < s_dimY; y++)
+    {
+      for (uint32_t x = 0; x < s_dimX; x++)
+      {
+        matrix->set(x, y, 0, 0.125 * x - 0.5 + offset);
+        matrix->set(x, y, 1, 0.25 * y - 0.75 - offset);
+      }
+    }
+    return matrix;
+  }
+
+  /**
+   * @brief The grid with a few nodes moved, the changed nodes span columns 2 to 5 and rows 1 to 3.
+   */
+  std::shared_ptr<const Matrix> recalibrated(const Matrix& matrix)
+  {
+    auto changed = std::make_shared<Matrix>(matrix);
+    changed->set(2, 3, 0, matrix.get(2, 3, 0) + 0.0625);
+    changed->set(5, 1, 1, matrix.get(5, 1, 1) - 0.125);
+    changed->set(4, 2, 0, matrix.get(4, 2, 0) + 0.25);
+    return changed;
+  }
+
+  /**
+   * @brief Same as MBitionWarpedOutput::uploadMatrix() for GL_RG32F.
+   */
+  void uploadFloat(Texture<float>& texture, const MatrixTextureModel& model, uint32_t index, const std::array<uint32_t, 4>& region)
+  {
+    if (region[0] >= region[2] || region[1] >= region[3])
+    {
+      return;
+    }
+    const size_t firstNode = size_t{region[1]} * s_dimX + region[0];
+    texture.subImage(region[0], index * s_dimY + region[1], region[2] - region[0], region[3] - region[1], s_dimX,
+                     model.getMatrix(index).data() + firstNode * 2);
+  }
+
+  /**
+   * @brief Same as MBitionWarpedOutput::uploadMatrix() for GL_RGBA8, two encoded texels per node.
+   */
+  void uploadEncoded(Texture<uint8_t>& texture, const MatrixTextureModel& model, uint32_t index,
+                     const std::array<uint32_t, 4>& region, std::vector<uint8_t>& staging)
+  {
+    if (region[0] >= region[2] || region[1] >= region[3])
+    {
+      return;
+    }
+    model.getTextureData(index, region[1], region[3], staging);
+    texture.subImage(region[0] * 2, index * s_dimY + region[1], (region[2] - region[0]) * 2, region[3] - region[1],
+                     s_dimX * 2, staging.data() + size_t{region[0]} * 2 * 4);
+  }
+
+  MatrixTextureModel model(float offset)
+  {
+    MatrixTextureModel result(s_matrixCount, s_dimX, s_dimY);
+    for (uint32_t index = 0; index < s_matrixCount; index++)
+    {
+      result.setMatrix(index, grid(offset + 0.5f * static_cast<float>(index)));
+    }
+    return result;
+  }
+
+  void testDifferingRegion()
+  {
+    const auto matrix = grid(0.0f);
+    const std::array<uint32_t, 4> none = matrix->differingRegion(*grid(0.0f));
+    ARHUD_CHECK(none[0] >= none[2] || none[1] >= none[3]);
+
+    const std::array<uint32_t, 4> region = recalibrated(*matrix)->differingRegion(*matrix);
+    ARHUD_CHECK((region == std::array<uint32_t, 4>{{2, 1, 6, 4}}));
+
+    // Another size differs everywhere.
+    const std::array<uint32_t, 4> resized = matrix->differingRegion(Matrix(s_dimX + 1, s_dimY));
+    ARHUD_CHECK((resized == std::array<uint32_t, 4>{{0, 0, s_dimX, s_dimY}}));
+  }
+
+  void testEncodedRows()
+  {
+    const MatrixTextureModel textures = model(0.0f);
+    std::vector<uint8_t> full;
+    textures.getTextureData(1, full);
+    std::vector<uint8_t> rows;
+    textures.getTextureData(1, 2, 5, rows);
+    const size_t rowBytes = size_t{s_dimX} * 2 * 4;
+    ARHUD_CHECK(rows.size() == 3 * rowBytes);
+    ARHUD_CHECK(std::vector<uint8_t>(full.begin() + 2 * rowBytes, full.begin() + 5 * rowBytes) == rows);
+
+    // The staging keeps its storage for smaller regions.
+    const uint8_t* storage = rows.data();
+    textures.getTextureData(1, 3, 4, rows);
+    ARHUD_CHECK(rows.data() == storage);
+    ARHUD_CHECK(rows.size() == rowBytes);
+  }
+
+  void testPartialUpload()
+  {
+    const std::array<uint32_t, 4> whole{{0, 0, s_dimX, s_dimY}};
+    const uint32_t changedIndex = 1;
+
+    MatrixTextureModel textures = model(0.0f);
+    Texture<float> floatPartial(s_dimX, s_dimY * s_matrixCount, 2);
+    Texture<uint8_t> encodedPartial(s_dimX * 2, s_dimY * s_matrixCount, 4);
+    std::vector<uint8_t> staging;
+    for (uint32_t index = 0; index < s_matrixCount; index++)
+    {
+      uploadFloat(floatPartial, textures, index, whole);
+      uploadEncoded(encodedPartial, textures, index, whole, staging);
+    }
+
+    // Recalibrate one matrix and upload only what changed.
+    const auto changed = recalibrated(textures.getMatrix(changedIndex));
+    const std::array<uint32_t, 4> region = changed->differingRegion(textures.getMatrix(changedIndex));
+    textures.setMatrix(changedIndex, changed);
+    uploadFloat(floatPartial, textures, changedIndex, region);
+    uploadEncoded(encodedPartial, textures, changedIndex, region, staging);
+
+    Texture<float> floatFull(s_dimX, s_dimY * s_matrixCount, 2);
+    std::vector<float> floatData;
+    textures.getFloatTextureData(floatData);
+    floatFull.subImage(0, 0, s_dimX, s_dimY * s_matrixCount, 0, floatData.data());
+    ARHUD_CHECK(floatPartial.texels == floatFull.texels);
+
+    Texture<uint8_t> encodedFull(s_dimX * 2, s_dimY * s_matrixCount, 4);
+    std::vector<uint8_t> encodedData;
+    textures.getTextureData(encodedData);
+    encodedFull.subImage(0, 0, s_dimX * 2, s_dimY * s_matrixCount, 0, encodedData.data());
+    ARHUD_CHECK(encodedPartial.texels == encodedFull.texels);
+  }
+}  // namespace
+
+int main()
+{
+  testDifferingRegion();
+  testEncodedRows();
+  testPartialUpload();
+  return TestSupport::result();
+}
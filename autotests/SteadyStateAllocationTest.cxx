@@ -0,0 +1,146 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Heap allocations of the calls made for every head pose request or every frame: the eye position interpolation of
+// the classic HUD and the mesh evaluation of the mini HUD. Building the models may allocate, using them must not.
+
+#include "MiniHudMeshModel.hxx"
+#include "TestSupport.hxx"
+#include "WarpingConstants.hxx"
+#include "WarpingMatrixInterpolationModel.hxx"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace
+{
+  std::atomic<uint64_t> s_allocations{0};
+}  // namespace
+
+// The models only allocate through operator new, the array forms forward to it.
+void* operator new(std::size_t size)
+{
+  s_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* memory = std::malloc(size > 0 ? size : 1))
+  {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t /*size*/) noexcept
+{
+  std::free(memory);
+}
+
+namespace
+{
+  constexpr uint32_t s_matrixCount = 4;
+  constexpr uint32_t s_levelCount  = 5;
+  constexpr float    s_windowWidth  = 1920.0f;
+  constexpr float    s_windowHeight = 720.0f;
+
+  uint64_t allocations()
+  {
+    return s_allocations.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Head position requests run setEyePosition() and getInterpolationParameters() and nothing else on the models.
+   */
+  void testEyePositionInterpolation()
+  {
+    Warping::WARPING_MATRIX_COUNT = s_matrixCount;
+    WarpingMatrixInterpolationModel model(s_matrixCount);
+    for (uint32_t index = 0; index < s_matrixCount; index++)
+    {
+      // Reference positions descend along the interpolation coordinate.
+      model.setReferenceEyePosition(index, {{0.0, 0.0, 1.0 - 0.1 * index}});
+    }
+
+    const uint64_t before = allocations();
+    int32_t        index  = -1;
+    float          factor = -1.0f;
+    for (uint32_t step = 0; step <= 1000; step++)
+    {
+      model.setEyePosition({{0.0, 0.0, 1.1 - 0.0005 * step}});
+      model.getInterpolationParameters(index, factor);
+    }
+    ARHUD_CHECK(allocations() == before);
+    ARHUD_CHECK(index == static_cast<int32_t>(s_matrixCount) - 2);
+    ARHUD_CHECK(factor == 1.0f);
+  }
+
+  /**
+   * @brief Parameter grid of one calibrated level: the control points spread over the window, shifted per level and
+   * slightly curved so that not every region is coarse.
+   */
+  MiniHudMeshModel::Parameters levelParameters(uint32_t level)
+  {
+    MiniHudMeshModel::Parameters parameters{};
+    for (uint32_t row = 0; row < MiniHudMeshModel::PARAMETER_GRID_Y; row++)
+    {
+      for (uint32_t column = 0; column < MiniHudMeshModel::PARAMETER_GRID_X; column++)
+      {
+        const float    u = static_cast<float>(column) / (MiniHudMeshModel::PARAMETER_GRID_X - 1);
+        const float    v = static_cast<float>(row) / (MiniHudMeshModel::PARAMETER_GRID_Y - 1);
+        const uint32_t p = 2 * column + 2 * MiniHudMeshModel::PARAMETER_GRID_X * row;
+        parameters[p]     = u * s_windowWidth + 4.0f * static_cast<float>(level);
+        parameters[p + 1] = v * s_windowHeight + 40.0f * u * u;
+      }
+    }
+    return parameters;
+  }
+
+  /**
+   * @brief Every mini HUD frame evaluates the mesh of its mirror level into the mapped vertex buffer and scissors to
+   * its bounds.
+   */
+  void testMiniHudMeshEvaluation()
+  {
+    std::vector<MiniHudMeshModel::Parameters> levels;
+    for (uint32_t level = 0; level < s_levelCount; level++)
+    {
+      levels.push_back(levelParameters(level));
+    }
+    MiniHudMeshModel model;
+    const uint64_t   beforeSetup = allocations();
+    model.setup(MiniHudMeshModel::layoutRegions({{0.0f, 0.0f, 1.0f, 1.0f}}), levels, s_windowWidth, s_windowHeight, 0.5f);
+    ARHUD_CHECK(model.isValid());
+    // Also makes sure that the allocations are counted at all.
+    ARHUD_CHECK(allocations() > beforeSetup);
+    std::vector<float> vertices(model.vertexCount() * MiniHudMeshModel::FLOATS_PER_VERTEX);
+
+    const uint64_t before = allocations();
+    for (float mirrorLevel = MiniHudMeshModel::MIRROR_LEVEL_MIN; mirrorLevel <= MiniHudMeshModel::MIRROR_LEVEL_MAX;
+         mirrorLevel += 0.0625f)
+    {
+      const MiniHudMeshModel::BasisWeights weights = MiniHudMeshModel::basisWeights(mirrorLevel, s_levelCount);
+      float                                weightSum = 0.0f;
+      for (const float weight : weights.weights)
+      {
+        weightSum += weight;
+      }
+      ARHUD_CHECK(TestSupport::fuzzyCompare(weightSum, 1.0, 1.0e-5));
+
+      model.evaluate(mirrorLevel, vertices.data());
+      const std::array<float, 4> bounds = model.bounds(mirrorLevel);
+      ARHUD_CHECK(bounds[0] < bounds[2] && bounds[1] < bounds[3]);
+    }
+    ARHUD_CHECK(allocations() == before);
+  }
+}  // namespace
+
+int main()
+{
+  testEyePositionInterpolation();
+  testMiniHudMeshEvaluation();
+  return TestSupport::result();
+}
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+/**
+ * @brief Minimal checks for the model tests, which run without a test framework. A failed check is reported and the
+ * test continues, main() returns TestSupport::result().
+ */
+namespace TestSupport
+{
+  inline int& failures()
+  {
+    static int count = 0;
+    return count;
+  }
+
+  inline void check(bool condition, const char* expression, const char* file, int line)
+  {
+    if (!condition)
+    {
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+      failures()++;
+    }
+  }
+
+  inline bool fuzzyCompare(double actual, double expected, double tolerance)
+  {
+    return std::abs(actual - expected) <= tolerance;
+  }
+
+  inline int result()
+  {
+    if (failures() > 0)
+    {
+      std::fprintf(stderr, "%d checks failed\n", failures());
+      return 1;
+    }
+    return 0;
+  }
+}  // namespace TestSupport
+
+#define ARHUD_CHECK(condition) TestSupport::check((condition), #condition, __FILE__, __LINE__)
@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Range checks of the tuning values that can be changed at runtime, see WarpingDBusInterface.
+
+#include "TestSupport.hxx"
+#include "WarpingConstants.hxx"
+
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+  void testMeshMaxErrorPixels()
+  {
+    // 0 draws the regular grid of the calibration data.
+    ARHUD_CHECK(Warping::isValidMeshMaxErrorPixels(0.0));
+    ARHUD_CHECK(Warping::isValidMeshMaxErrorPixels(0.5));
+    ARHUD_CHECK(Warping::isValidMeshMaxErrorPixels(Warping::MESH_MAX_ERROR_PIXELS_LIMIT));
+
+    ARHUD_CHECK(!Warping::isValidMeshMaxErrorPixels(-0.25));
+    ARHUD_CHECK(!Warping::isValidMeshMaxErrorPixels(Warping::MESH_MAX_ERROR_PIXELS_LIMIT + 0.5));
+    ARHUD_CHECK(!Warping::isValidMeshMaxErrorPixels(1.0e9));
+    ARHUD_CHECK(!Warping::isValidMeshMaxErrorPixels(std::numeric_limits<double>::infinity()));
+    ARHUD_CHECK(!Warping::isValidMeshMaxErrorPixels(std::numeric_limits<double>::quiet_NaN()));
+  }
+
+  void testMeshMinSubdivision()
+  {
+    for (uint32_t subdivision = 0; subdivision <= Warping::MESH_MIN_SUBDIVISION_LIMIT; subdivision++)
+    {
+      ARHUD_CHECK(Warping::isValidMeshMinSubdivision(subdivision));
+    }
+    ARHUD_CHECK(!Warping::isValidMeshMinSubdivision(Warping::MESH_MIN_SUBDIVISION_LIMIT + 1));
+    // A negative value sent as uint.
+    ARHUD_CHECK(!Warping::isValidMeshMinSubdivision(std::numeric_limits<uint32_t>::max()));
+  }
+
+  void testDefaults()
+  {
+    // The writable tuning is opt-in, and the defaults pass their own checks.
+    ARHUD_CHECK(!Warping::DBUS_TUNING);
+    ARHUD_CHECK(Warping::isValidMeshMaxErrorPixels(Warping::MESH_MAX_ERROR_PIXELS));
+    ARHUD_CHECK(Warping::isValidMeshMinSubdivision(Warping::MESH_MIN_SUBDIVISION));
+  }
+}  // namespace
+
+int main()
+{
+  testMeshMaxErrorPixels();
+  testMeshMinSubdivision();
+  testDefaults();
+  return TestSupport::result();
+}
@@ -0,0 +1,289 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "AdaptiveMeshBuilder.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+
+namespace Warping
+{
+
+  namespace
+  {
+    using Point = std::array<uint32_t, 2>;
+
+    uint64_t pointKey(uint32_t x, uint32_t y)
+    {
+      return (static_cast<uint64_t>(x) << 32) | y;
+    }
+  }
+
+  AdaptiveMeshBuilder::AdaptiveMeshBuilder(uint32_t cellsX, uint32_t cellsY)
+    : mCellsX(cellsX), mCellsY(cellsY)
+  {
+  }
+
+  /**
+   * @brief Sets the largest tolerated distance in pixels between the warp and its triangle approximation. A value
+   * of 0 results in the regular grid of the calibration data.
+   */
+  void AdaptiveMeshBuilder::setMaxErrorPixels(float64_t maxError)
+  {
+    mMaxError = std::max(maxError, 0.0);
+  }
+
+  /**
+   * @brief Sets the edge length in grid cells of the largest quad. Rounded down to a power of two.
+   */
+  void AdaptiveMeshBuilder::setMaxMergeCells(uint32_t cells)
+  {
+    uint32_t powerOfTwo = 1;
+    while (powerOfTwo * 2 <= cells)
+    {
+      powerOfTwo *= 2;
+    }
+    mMaxMergeCells = powerOfTwo;
+  }
+
+  /**
+   * @brief Sets how often a grid cell may be halved.
+   */
+  void AdaptiveMeshBuilder::setMaxSubdivision(uint32_t levels)
+  {
+    mMaxSubdivision = std::min(levels, 8u);
+    mMinSubdivision = std::min(mMinSubdivision, mMaxSubdivision);
+  }
+
+  /**
+   * @brief Sets how often every grid cell is halved regardless of the error. Raises the maximum subdivision if needed.
+   */
+  void AdaptiveMeshBuilder::setMinSubdivision(uint32_t levels)
+  {
+    mMinSubdivision = std::min(levels, 8u);
+    mMaxSubdivision = std::max(mMaxSubdivision, mMinSubdivision);
+  }
+
+  void AdaptiveMeshBuilder::addSurface(Surface surface)
+  {
+    mSurfaces.push_back(std::move(surface));
+  }
+
+  /**
+   * @brief Returns the size of a lattice unit in grid nodes. The lattice is the grid subdivided maxSubdivision times.
+   */
+  float64_t AdaptiveMeshBuilder::latticeToNodes() const
+  {
+    return 1.0 / static_cast<float64_t>(1u << mMaxSubdivision);
+  }
+
+  /**
+   * @brief Estimates the error of drawing a quad as the two triangles (x0, y1, x1, y0, x0, y0) and
+   * (x0, y1, x1, y1, x1, y0) by sampling the surfaces four times per grid cell, enough to follow the curvature of
+   * bicubic surfaces.
+   *
+   * @param[in] quad The quad in lattice units.
+   * @param[in] bound The sampling stops as soon as the error exceeds this bound.
+   *
+   * @return The largest distance in pixels between any surface and the triangles at the sample points.
+   */
+  float64_t AdaptiveMeshBuilder::error(const Quad& quad, float64_t bound) const
+  {
+    const uint32_t  lattice = 1u << mMaxSubdivision;
+    const uint32_t  step    = std::max(lattice / 4, 1u);
+    const float64_t scale   = latticeToNodes();
+
+    const float64_t w = static_cast<float64_t>(quad.x1 - quad.x0);
+    const float64_t h = static_cast<float64_t>(quad.y1 - quad.y0);
+
+    float64_t maxError = 0.0;
+    for (const Surface& surface : mSurfaces)
+    {
+      const auto p00 = surface(quad.x0 * scale, quad.y0 * scale);
+      const auto p10 = surface(quad.x1 * scale, quad.y0 * scale);
+      const auto p01 = surface(quad.x0 * scale, quad.y1 * scale);
+      const auto p11 = surface(quad.x1 * scale, quad.y1 * scale);
+
+      for (uint32_t y = quad.y0; y <= quad.y1; y += std::min(step, std::max(quad.y1 - y, 1u)))
+      {
+        for (uint32_t x = quad.x0; x <= quad.x1; x += std::min(step, std::max(quad.x1 - x, 1u)))
+        {
+          const float64_t s = static_cast<float64_t>(x - quad.x0) / w;
+          const float64_t t = static_cast<float64_t>(y - quad.y0) / h;
+
+          // Linear interpolation inside the triangle of the quad containing (s, t).
+          std::array<float64_t, 2> approximation;
+          for (uint32_t c = 0; c < 2; c++)
+          {
+            if (s + t <= 1.0)
+            {
+              approximation[c] = p00[c] + s * (p10[c] - p00[c]) + t * (p01[c] - p00[c]);
+            }
+            else
+            {
+              approximation[c] = p11[c] + (1.0 - s) * (p01[c] - p11[c]) + (1.0 - t) * (p10[c] - p11[c]);
+            }
+          }
+
+          const auto reference = surface(x * scale, y * scale);
+          maxError = std::max(maxError, std::hypot(reference[0] - approximation[0], reference[1] - approximation[1]));
+          if (maxError > bound)
+          {
+            return maxError;
+          }
+        }
+      }
+    }
+    return maxError;
+  }
+
+  void AdaptiveMeshBuilder::refine(const Quad& quad, std::vector<Quad>& leaves, float64_t& maxError) const
+  {
+    const uint32_t w = quad.x1 - quad.x0;
+    const uint32_t h = quad.y1 - quad.y0;
+
+    const uint32_t  minSize   = (1u << mMaxSubdivision) >> mMinSubdivision;
+    const float64_t quadError = w > minSize || h > minSize ? std::numeric_limits<float64_t>::infinity() : error(quad, mMaxError);
+    if (quadError <= mMaxError || (w <= 1 && h <= 1))
+    {
+      leaves.push_back(quad);
+      maxError = std::max(maxError, quadError);
+      return;
+    }
+
+    const uint32_t xm = w > 1 ? quad.x0 + w / 2 : quad.x1;
+    const uint32_t ym = h > 1 ? quad.y0 + h / 2 : quad.y1;
+
+    refine({quad.x0, quad.y0, xm, ym}, leaves, maxError);
+    if (xm < quad.x1)
+    {
+      refine({xm, quad.y0, quad.x1, ym}, leaves, maxError);
+    }
+    if (ym < quad.y1)
+    {
+      refine({quad.x0, ym, xm, quad.y1}, leaves, maxError);
+    }
+    if (xm < quad.x1 && ym < quad.y1)
+    {
+      refine({xm, ym, quad.x1, quad.y1}, leaves, maxError);
+    }
+  }
+
+  std::vector<std::array<float, 2>> AdaptiveMeshBuilder::build(MeshStatistics& statistics) const
+  {
+    const uint32_t lattice = 1u << mMaxSubdivision;
+    const uint32_t width   = mCellsX * lattice;
+    const uint32_t height  = mCellsY * lattice;
+
+    // Without a tolerance the mesh is the regular grid, as before the adaptive tessellation.
+    const uint32_t block = mMaxError > 0.0 ? mMaxMergeCells * lattice : lattice >> mMinSubdivision;
+
+    std::vector<Quad> leaves;
+    float64_t         maxError = 0.0;
+    for (uint32_t y = 0; y < height; y += block)
+    {
+      for (uint32_t x = 0; x < width; x += block)
+      {
+        const Quad root = {x, y, std::min(x + block, width), std::min(y + block, height)};
+        if (mMaxError > 0.0)
+        {
+          refine(root, leaves, maxError);
+        }
+        else
+        {
+          leaves.push_back(root);
+          maxError = std::max(maxError, error(root, std::numeric_limits<float64_t>::infinity()));
+        }
+      }
+    }
+
+    std::unordered_set<uint64_t> corners;
+    corners.reserve(leaves.size() * 4);
+    for (const Quad& quad : leaves)
+    {
+      corners.insert(pointKey(quad.x0, quad.y0));
+      corners.insert(pointKey(quad.x1, quad.y0));
+      corners.insert(pointKey(quad.x0, quad.y1));
+      corners.insert(pointKey(quad.x1, quad.y1));
+    }
+
+    const float invWidth  = 1.0f / static_cast<float>(width);
+    const float invHeight = 1.0f / static_cast<float>(height);
+    auto        texcoord  = [invWidth, invHeight](float x, float y)
+    {
+      return std::array<float, 2>{{x * invWidth, y * invHeight}};
+    };
+
+    std::vector<std::array<float, 2>> vertices;
+    vertices.reserve(leaves.size() * 6);
+    std::vector<Point> ring;
+    for (const Quad& quad : leaves)
+    {
+      // Corners of finer neighbours lying on the edges of this quad, counter-clockwise starting at (x0, y0).
+      ring.clear();
+      for (uint32_t x = quad.x0; x < quad.x1; x++)
+      {
+        if (x == quad.x0 || corners.count(pointKey(x, quad.y0)))
+        {
+          ring.push_back({x, quad.y0});
+        }
+      }
+      for (uint32_t y = quad.y0; y < quad.y1; y++)
+      {
+        if (y == quad.y0 || corners.count(pointKey(quad.x1, y)))
+        {
+          ring.push_back({quad.x1, y});
+        }
+      }
+      for (uint32_t x = quad.x1; x > quad.x0; x--)
+      {
+        if (x == quad.x1 || corners.count(pointKey(x, quad.y1)))
+        {
+          ring.push_back({x, quad.y1});
+        }
+      }
+      for (uint32_t y = quad.y1; y > quad.y0; y--)
+      {
+        if (y == quad.y1 || corners.count(pointKey(quad.x0, y)))
+        {
+          ring.push_back({quad.x0, y});
+        }
+      }
+
+      const float x0 = static_cast<float>(quad.x0);
+      const float y0 = static_cast<float>(quad.y0);
+      const float x1 = static_cast<float>(quad.x1);
+      const float y1 = static_cast<float>(quad.y1);
+
+      if (ring.size() == 4)
+      {
+        // Same triangulation as the regular grid.
+        vertices.push_back(texcoord(x0, y1));
+        vertices.push_back(texcoord(x1, y0));
+        vertices.push_back(texcoord(x0, y0));
+        vertices.push_back(texcoord(x0, y1));
+        vertices.push_back(texcoord(x1, y1));
+        vertices.push_back(texcoord(x1, y0));
+        continue;
+      }
+
+      const std::array<float, 2> centre = texcoord(0.5f * (x0 + x1), 0.5f * (y0 + y1));
+      for (size_t i = 0; i < ring.size(); i++)
+      {
+        const Point& a = ring[i];
+        const Point& b = ring[(i + 1) % ring.size()];
+        vertices.push_back(centre);
+        vertices.push_back(texcoord(static_cast<float>(a[0]), static_cast<float>(a[1])));
+        vertices.push_back(texcoord(static_cast<float>(b[0]), static_cast<float>(b[1])));
+      }
+    }
+
+    statistics.vertexCount          = static_cast<uint32_t>(vertices.size());
+    statistics.quadCount            = static_cast<uint32_t>(leaves.size());
+    statistics.estimatedErrorPixels = maxError;
+    return vertices;
+  }
+
+}  // namespace Warping
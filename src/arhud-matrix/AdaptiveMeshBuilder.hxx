@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "WarpingUtils.hxx"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Warping
+{
+
+  /**
+   * @brief Statistics of a mesh built by the AdaptiveMeshBuilder.
+   */
+  struct MeshStatistics
+  {
+    uint32_t  vertexCount          = 0;
+    uint32_t  quadCount            = 0;
+    float64_t estimatedErrorPixels = 0.0;
+  };
+
+  /**
+   * @brief Builds a triangle mesh over a warping grid whose density follows the local curvature of the warp.
+   *
+   * The grid is covered by blocks of up to maxMergeCells x maxMergeCells cells which are split in a quadtree until
+   * the triangles approximate every registered surface within the maximum pixel error, down to
+   * 2^maxSubdivision x 2^maxSubdivision quads per grid cell. Every grid cell is split at least minSubdivision times,
+   * which renders a mesh denser than the calibration grid for smooth interpolation between its nodes. T-junctions between quads of different size are stitched
+   * with a triangle fan around the quad centre.
+   */
+  class AdaptiveMeshBuilder final
+  {
+  public:
+    /**
+     * @brief Maps a position in grid node units to the warped position in pixels.
+     */
+    using Surface = std::function<std::array<float64_t, 2>(float64_t x, float64_t y)>;
+
+    AdaptiveMeshBuilder(uint32_t cellsX, uint32_t cellsY);
+
+    void setMaxErrorPixels(float64_t maxError);
+    void setMaxMergeCells(uint32_t cells);
+    void setMaxSubdivision(uint32_t levels);
+    void setMinSubdivision(uint32_t levels);
+
+    /**
+     * @brief Adds a surface the mesh has to approximate. The error is the maximum over all surfaces.
+     */
+    void addSurface(Surface surface);
+
+    /**
+     * @brief Builds the triangle list.
+     *
+     * @param[out] statistics Vertex count and the largest estimated error of the mesh.
+     *
+     * @return The triangle vertices as texture coordinates in [0, 1] x [0, 1] over the whole grid.
+     */
+    std::vector<std::array<float, 2>> build(MeshStatistics& statistics) const;
+
+  private:
+    struct Quad
+    {
+      uint32_t x0;
+      uint32_t y0;
+      uint32_t x1;
+      uint32_t y1;
+    };
+
+    void      refine(const Quad& quad, std::vector<Quad>& leaves, float64_t& maxError) const;
+    float64_t error(const Quad& quad, float64_t bound) const;
+    float64_t latticeToNodes() const;
+
+    uint32_t  mCellsX;
+    uint32_t  mCellsY;
+    float64_t mMaxError       = 0.5;
+    uint32_t  mMaxMergeCells  = 4;
+    uint32_t  mMaxSubdivision = 2;
+    uint32_t  mMinSubdivision = 0;
+
+    std::vector<Surface> mSurfaces;
+  };
+
+}  // namespace Warping
@@ -16,7 +16,7 @@ MatrixTextureModel::MatrixTextureModel(uint32_t matrixCount, uint32_t x_dim, uin
   mMatrices.reserve(matrixCount);
   for (uint32_t i = 0; i < matrixCount; i++)
   {
-    mMatrices.emplace_back(x_dim, y_dim);
+    mMatrices.push_back(std::make_shared<const Matrix>(x_dim, y_dim));
   }
 }
 
@@ -30,7 +30,7 @@ MatrixTextureModel::MatrixTextureModel(uint32_t matrixCount, uint32_t x_dim, uin
  */
 const Matrix& MatrixTextureModel::getMatrix(uint32_t index) const
 {
-  return mMatrices.at(index);
+  return *mMatrices.at(index);
 }
 
 /**
@@ -39,11 +39,11 @@ const Matrix& MatrixTextureModel::getMatrix(uint32_t index) const
  * @param[in] index The index where the matrix has to be set.
  * @param[in] m The matrix to set.
  */
-void MatrixTextureModel::setMatrix(uint32_t index, const Matrix& m)
+void MatrixTextureModel::setMatrix(uint32_t index, MatrixPointer m)
 {
-  if (m.dimX() == mDimX && m.dimY() == mDimY)
+  if (m && m->dimX() == mDimX && m->dimY() == mDimY)
   {
-    mMatrices.at(index) = m;
+    mMatrices.at(index) = std::move(m);
   }
 }
 
@@ -52,49 +52,104 @@ void MatrixTextureModel::setMatrix(uint32_t index, const Matrix& m)
  *
  * @param[in] matrices The matrix array.
  */
-void MatrixTextureModel::setMatrices(const std::vector<Matrix>& matrices)
+void MatrixTextureModel::setMatrices(const std::vector<MatrixPointer>& matrices)
 {
   mMatrices = matrices;
 }
 
 /**
- * @brief Returns the texture data so that all double values are in 4-byte integers encoded.
- *
- * @return The texture data in integers encoded.
+ * @brief Encodes elements of a matrix in 4-byte integers, starting at the given element.
  */
-std::vector<uint8_t> MatrixTextureModel::getTextureData() const
+static uint8_t* encodeMatrix(const Matrix& matrix, size_t firstElement, size_t elementCount, uint8_t* target)
 {
-  auto matrixCount        = mMatrices.size();
-  auto matrixElementCount = mDimX * mDimY * 2;
+  const float* source    = matrix.data() + firstElement;
+  const float* sourceEnd = source + elementCount;
 
-  std::vector<uint8_t> bytes(matrixCount * matrixElementCount * 4);
+  while (source < sourceEnd)
+  {
+    float64_t value = *source;
 
-  uint8_t* target = bytes.data();
+    // We accept a displacement range in [-2.0, 2.0].
+    float64_t d = std::clamp(value * 0.25 + 0.5, 0.0, 1.0);
+    uint32_t  u = static_cast<uint32_t>(std::round(d * static_cast<float64_t>(std::numeric_limits<uint32_t>::max())));
 
-  for (const Matrix& matrix : mMatrices)
-  {
-    const float64_t* source    = matrix.data();
-    const float64_t* sourceEnd = source + matrixElementCount;
+    const uint32_t byteMask = 0xffU;
+
+    target[0] = static_cast<uint8_t>(u & byteMask);
+    target[1] = static_cast<uint8_t>((u >> 8) & byteMask);
+    target[2] = static_cast<uint8_t>((u >> 16) & byteMask);
+    target[3] = static_cast<uint8_t>((u >> 24) & byteMask);
+
+    source += 1;
+    target += 4;
+  }
+  return target;
+}
+
+/**
+ * @brief Writes the texture data so that all values are in 4-byte integers encoded.
+ *
+ * @param[out] bytes The texture data in integers encoded. Its storage is reused, so repeated updates do not allocate.
+ */
+void MatrixTextureModel::getTextureData(std::vector<uint8_t>& bytes) const
+{
+  const size_t matrixElementCount = static_cast<size_t>(mDimX) * mDimY * 2;
+  bytes.resize(mMatrices.size() * matrixElementCount * 4);
 
-    while (source < sourceEnd)
-    {
-      float64_t value = *source;
+  uint8_t* target = bytes.data();
+  for (const MatrixPointer& matrix : mMatrices)
+  {
+    target = encodeMatrix(*matrix, 0, matrixElementCount, target);
+  }
+}
 
-      // We accept a displacement range in [-2.0, 2.0].
-      float64_t d = std::clamp(value * 0.25 + 0.5, 0.0, 1.0);
-      uint32_t  u = static_cast<uint32_t>(std::round(d * static_cast<float64_t>(std::numeric_limits<uint32_t>::max())));
+/**
+ * @brief Writes the texture data of a single matrix, the rows of the texture holding it.
+ *
+ * @param[in] index The index of the matrix.
+ * @param[out] bytes The texture data in integers encoded.
+ */
+void MatrixTextureModel::getTextureData(uint32_t index, std::vector<uint8_t>& bytes) const
+{
+  getTextureData(index, 0, mDimY, bytes);
+}
 
-      const uint32_t byteMask = 0xffU;
+/**
+ * @brief Writes the texture data of a range of rows of a single matrix, for updating part of the texture.
+ *
+ * @param[in] index The index of the matrix.
+ * @param[in] rowBegin The first row to encode.
+ * @param[in] rowEnd The row after the last one to encode, at most the height of the matrix.
+ * @param[out] bytes The texture data in integers encoded, starting with rowBegin. Its storage is reused, so repeated
+ * updates do not allocate.
+ */
+void MatrixTextureModel::getTextureData(uint32_t index, uint32_t rowBegin, uint32_t rowEnd, std::vector<uint8_t>& bytes) const
+{
+  rowEnd   = std::min(rowEnd, mDimY);
+  rowBegin = std::min(rowBegin, rowEnd);
+  const size_t rowElementCount = static_cast<size_t>(mDimX) * 2;
+  bytes.resize((rowEnd - rowBegin) * rowElementCount * 4);
+  encodeMatrix(*mMatrices.at(index), rowBegin * rowElementCount, (rowEnd - rowBegin) * rowElementCount, bytes.data());
+}
 
-      target[0] = static_cast<uint8_t>(u & byteMask);
-      target[1] = static_cast<uint8_t>((u >> 8) & byteMask);
-      target[2] = static_cast<uint8_t>((u >> 16) & byteMask);
-      target[3] = static_cast<uint8_t>((u >> 24) & byteMask);
+/**
+ * @brief Writes the texture data as two floats per element, for a RG32F texture with one texel per element.
+ *
+ * @param[out] values The texture data in floats. Its storage is reused, so repeated updates do not allocate.
+ */
+void MatrixTextureModel::getFloatTextureData(std::vector<float>& values) const
+{
+  const size_t matrixElementCount = static_cast<size_t>(mDimX) * mDimY * 2;
+  values.resize(mMatrices.size() * matrixElementCount);
 
-      source += 1;
-      target += 4;
-    }
+  float* target = values.data();
+  for (const MatrixPointer& matrix : mMatrices)
+  {
+    target = std::copy(matrix->data(), matrix->data() + matrixElementCount, target);
   }
+}
 
-  return bytes;
+size_t MatrixTextureModel::memoryBytes() const
+{
+  return mMatrices.size() * static_cast<size_t>(mDimX) * mDimY * 2 * sizeof(float);
 }
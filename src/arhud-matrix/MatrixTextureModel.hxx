@@ -7,26 +7,39 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 
 using namespace Warping;
 
 /**
- * @brief Stores the warping matrices in floating-point representation and implements the conversion to matrix texture
- * byte data form.
+ * @brief Stores the warping matrices and implements the conversion to matrix texture data.
+ *
+ * The matrices are immutable and shared: a published calibration refers to the same matrices as the model, setting a
+ * matrix replaces only that one.
  */
 class MatrixTextureModel final
 {
 public:
+  using MatrixPointer = std::shared_ptr<const Matrix>;
+
   MatrixTextureModel(uint32_t matrixCount, uint32_t x_dim, uint32_t y_dim);
   const Matrix&         getMatrix(uint32_t index) const;
-  void                  setMatrix(uint32_t index, const Matrix& m);
-  void                  setMatrices(const std::vector<Matrix>& matrices);
-  std::vector<uint8_t>  getTextureData() const;
+  void                  setMatrix(uint32_t index, MatrixPointer m);
+  void                  setMatrices(const std::vector<MatrixPointer>& matrices);
+  void                  getTextureData(std::vector<uint8_t>& bytes) const;
+  void                  getTextureData(uint32_t index, std::vector<uint8_t>& bytes) const;
+  void                  getTextureData(uint32_t index, uint32_t rowBegin, uint32_t rowEnd, std::vector<uint8_t>& bytes) const;
+  void                  getFloatTextureData(std::vector<float>& values) const;
+
+  /**
+   * @brief Returns the memory of the stored matrices in bytes.
+   */
+  size_t                memoryBytes() const;
 
   /**
    * @brief Stores array of matrices.
    */
   uint32_t mDimX;
   uint32_t mDimY;
-  std::vector<Matrix> mMatrices;
+  std::vector<MatrixPointer> mMatrices;
 };
@@ -17,4 +17,26 @@ namespace Warping
   uint32_t CONTENT_RESOLUTION_Y = 80;
   uint32_t WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X = 12;
   uint32_t WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y = 12;
+  float MESH_MAX_ERROR_PIXELS = 0.5f;
+  uint32_t MESH_MIN_SUBDIVISION = 0;
+  bool MESH_BICUBIC_INTERPOLATION = false;
+  std::string CLASSIC_HUD_OFFSCREEN_FORMAT = "RGBA8";
+  std::string MINI_HUD_OFFSCREEN_FORMAT = "RGBA8";
+  float FRAME_BUDGET_MS = 0.0f;
+  bool PERFORMANCE_OVERLAY = false;
+  uint32_t OFFSCREEN_RING_DEPTH = 2;
+  bool WARP_ONLY_REPROJECTION = true;
+  std::string PROTOCOL_TRACE_FILE;
+  bool DBUS_TUNING = false;
+
+  bool isValidMeshMaxErrorPixels(double pixels)
+  {
+    // Also rejects NaN.
+    return pixels >= 0.0 && pixels <= MESH_MAX_ERROR_PIXELS_LIMIT;
+  }
+
+  bool isValidMeshMinSubdivision(uint32_t subdivision)
+  {
+    return subdivision <= MESH_MIN_SUBDIVISION_LIMIT;
+  }
 }
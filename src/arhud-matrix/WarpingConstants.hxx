@@ -7,6 +7,7 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 
 namespace Warping
 {
@@ -54,4 +55,87 @@ namespace Warping
    * @brief Defines the height (number of vertices in a column / y-direction) of the extrapolated warping matrix.
    */
   extern uint32_t WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y;
+
+  /**
+   * @brief Defines the largest tolerated distance in pixels between the warp and the adaptively tessellated mesh.
+   * 0 draws the regular grid of the calibration data.
+   */
+  extern float MESH_MAX_ERROR_PIXELS;
+
+  /**
+   * @brief Defines how often every cell of the warping matrix is at least halved by the warp mesh.
+   */
+  extern uint32_t MESH_MIN_SUBDIVISION;
+
+  /**
+   * @brief Largest accepted MESH_MAX_ERROR_PIXELS, coarser meshes visibly bend straight content.
+   */
+  constexpr float MESH_MAX_ERROR_PIXELS_LIMIT = 16.0f;
+
+  /**
+   * @brief Largest accepted MESH_MIN_SUBDIVISION, every level quadruples the triangles of the mesh.
+   */
+  constexpr uint32_t MESH_MIN_SUBDIVISION_LIMIT = 3;
+
+  /**
+   * @brief Returns whether the tolerance is within 0 to MESH_MAX_ERROR_PIXELS_LIMIT.
+   */
+  bool isValidMeshMaxErrorPixels(double pixels);
+
+  /**
+   * @brief Returns whether the subdivision is within 0 to MESH_MIN_SUBDIVISION_LIMIT.
+   */
+  bool isValidMeshMinSubdivision(uint32_t subdivision);
+
+  /**
+   * @brief Defines whether the warp between the matrix nodes is interpolated by Catmull-Rom splines instead of
+   * bilinearly.
+   */
+  extern bool MESH_BICUBIC_INTERPOLATION;
+
+  /**
+   * @brief Defines the color format of the offscreen texture of the classic HUD: RGBA8, RGB10_A2 or RGB565.
+   */
+  extern std::string CLASSIC_HUD_OFFSCREEN_FORMAT;
+
+  /**
+   * @brief Defines the color format of the offscreen texture of the mini HUD: RGBA8, RGB10_A2 or RGB565.
+   */
+  extern std::string MINI_HUD_OFFSCREEN_FORMAT;
+
+  /**
+   * @brief Defines the frame time budget in milliseconds of each HUD output. Exceeding it lowers the warp quality,
+   * 0 disables the governor.
+   */
+  extern float FRAME_BUDGET_MS;
+
+  /**
+   * @brief Defines whether the frame times and the pose age are drawn into the HUD content before warping, see
+   * PerformanceOverlay. Meant for bench debugging only.
+   */
+  extern bool PERFORMANCE_OVERLAY;
+
+  /**
+   * @brief Defines the number of offscreen targets each HUD renders consecutive frames into in turn, 1 to 3. More
+   * targets keep the scene pass from waiting for the warp of the previous frame at the cost of their memory.
+   */
+  extern uint32_t OFFSCREEN_RING_DEPTH;
+
+  /**
+   * @brief Defines whether a frame whose HUD content did not change since the last one only warps the previous
+   * offscreen target with the new head pose or mirror level instead of rendering the scene again.
+   */
+  extern bool WARP_ONLY_REPROJECTION;
+
+  /**
+   * @brief Defines the file every incoming warping protocol request is recorded to, see ProtocolTraceWriter.
+   * Empty disables the recording.
+   */
+  extern std::string PROTOCOL_TRACE_FILE;
+
+  /**
+   * @brief Defines whether the tuning properties on the session bus are writable, see WarpingDBusInterface. Off by
+   * default, the telemetry is readable either way.
+   */
+  extern bool DBUS_TUNING;
 }
@@ -6,17 +6,13 @@
 
 #include "WarpingUtils.hxx"
 
+#include <algorithm>
+
 namespace Warping
 {
   Matrix::Matrix(uint32_t x_dim, uint32_t y_dim, float *values)
-    : mDimX(x_dim), mDimY(y_dim), mElements(x_dim * y_dim * 2)
+    : mDimX(x_dim), mDimY(y_dim), mElements(values, values + static_cast<size_t>(x_dim) * y_dim * 2)
   {
-    uint32_t count = x_dim * y_dim * 2;
-
-    for (uint32_t i = 0; i < count; i++)
-    {
-      mElements[i] = values[i];
-    }
   }
 
   float64_t Matrix::get(uint32_t x, uint32_t y, uint32_t z) const
@@ -33,8 +29,124 @@ namespace Warping
   {
     if (x < mDimX && y < mDimY && z < 2)
     {
-      mElements[(y * mDimX + x) * 2 + z] = value;
+      mElements[(y * mDimX + x) * 2 + z] = static_cast<float>(value);
+    }
+  }
+
+  /**
+   * @brief Interpolates the matrix bilinearly between its elements, like the warping vertex shader does for vertices
+   * that do not lie on the grid.
+   *
+   * @param[in] x The horizontal position in element units, clamped to [0, dimX - 1].
+   * @param[in] y The vertical position in element units, clamped to [0, dimY - 1].
+   *
+   * @return Both components at the given position.
+   */
+  std::array<float64_t, 2> Matrix::sampleBilinear(float64_t x, float64_t y) const
+  {
+    x = std::clamp(x, 0.0, static_cast<float64_t>(mDimX - 1));
+    y = std::clamp(y, 0.0, static_cast<float64_t>(mDimY - 1));
+
+    const uint32_t  x0 = std::min(static_cast<uint32_t>(x), mDimX > 1 ? mDimX - 2 : 0);
+    const uint32_t  y0 = std::min(static_cast<uint32_t>(y), mDimY > 1 ? mDimY - 2 : 0);
+    const float64_t fx = x - x0;
+    const float64_t fy = y - y0;
+
+    std::array<float64_t, 2> result;
+    for (uint32_t c = 0; c < 2; c++)
+    {
+      const float64_t top    = get(x0, y0, c) * (1.0 - fx) + get(x0 + 1, y0, c) * fx;
+      const float64_t bottom = get(x0, y0 + 1, c) * (1.0 - fx) + get(x0 + 1, y0 + 1, c) * fx;
+      result[c]              = top * (1.0 - fy) + bottom * fy;
+    }
+    return result;
+  }
+
+  /**
+   * @brief Interpolates the matrix with uniform Catmull-Rom splines between its elements. Neighbours outside the
+   * matrix are clamped to the border elements. This is the reference of the bicubic warping vertex shader.
+   *
+   * @param[in] x The horizontal position in element units, clamped to [0, dimX - 1].
+   * @param[in] y The vertical position in element units, clamped to [0, dimY - 1].
+   *
+   * @return Both components at the given position.
+   */
+  std::array<float64_t, 2> Matrix::sampleBicubic(float64_t x, float64_t y) const
+  {
+    x = std::clamp(x, 0.0, static_cast<float64_t>(mDimX - 1));
+    y = std::clamp(y, 0.0, static_cast<float64_t>(mDimY - 1));
+
+    const int32_t   x0 = static_cast<int32_t>(std::min(static_cast<uint32_t>(x), mDimX > 1 ? mDimX - 2 : 0));
+    const int32_t   y0 = static_cast<int32_t>(std::min(static_cast<uint32_t>(y), mDimY > 1 ? mDimY - 2 : 0));
+    const float64_t fx = x - x0;
+    const float64_t fy = y - y0;
+
+    auto weights = [](float64_t t) -> std::array<float64_t, 4>
+    {
+      const float64_t t2 = t * t;
+      const float64_t t3 = t2 * t;
+      return {{0.5 * (-t + 2.0 * t2 - t3),
+               0.5 * (2.0 - 5.0 * t2 + 3.0 * t3),
+               0.5 * (t + 4.0 * t2 - 3.0 * t3),
+               0.5 * (-t2 + t3)}};
+    };
+    const std::array<float64_t, 4> wx = weights(fx);
+    const std::array<float64_t, 4> wy = weights(fy);
+
+    const int32_t maxX = static_cast<int32_t>(mDimX) - 1;
+    const int32_t maxY = static_cast<int32_t>(mDimY) - 1;
+
+    std::array<float64_t, 2> result = {{0.0, 0.0}};
+    for (int32_t j = 0; j < 4; j++)
+    {
+      const uint32_t row = static_cast<uint32_t>(std::clamp(y0 + j - 1, int32_t{0}, maxY));
+      for (int32_t i = 0; i < 4; i++)
+      {
+        const uint32_t  column = static_cast<uint32_t>(std::clamp(x0 + i - 1, int32_t{0}, maxX));
+        const float64_t weight = wx[i] * wy[j];
+        result[0] += weight * get(column, row, 0);
+        result[1] += weight * get(column, row, 1);
+      }
+    }
+    return result;
+  }
+
+  /**
+   * @brief Returns the bounds of the elements that differ from another matrix of the same size. A recalibration that
+   * only changed part of the grid then only needs that part uploaded.
+   *
+   * @param[in] other The matrix to compare with.
+   *
+   * @return The bounds {x0, y0, x1, y1}, the upper ones exclusive. All zero if the matrices are equal, the whole
+   * matrix if their sizes differ.
+   */
+  std::array<uint32_t, 4> Matrix::differingRegion(const Matrix& other) const
+  {
+    if (other.mDimX != mDimX || other.mDimY != mDimY)
+    {
+      return {{0, 0, mDimX, mDimY}};
+    }
+
+    std::array<uint32_t, 4> region{{mDimX, mDimY, 0, 0}};
+    for (uint32_t y = 0; y < mDimY; y++)
+    {
+      for (uint32_t x = 0; x < mDimX; x++)
+      {
+        const size_t index = (static_cast<size_t>(y) * mDimX + x) * 2;
+        if (mElements[index] != other.mElements[index] || mElements[index + 1] != other.mElements[index + 1])
+        {
+          region[0] = std::min(region[0], x);
+          region[1] = std::min(region[1], y);
+          region[2] = std::max(region[2], x + 1);
+          region[3] = std::max(region[3], y + 1);
+        }
+      }
+    }
+    if (region[2] == 0)
+    {
+      return {};
     }
+    return region;
   }
 
   /**
@@ -19,6 +19,10 @@ typedef std::enable_if<std::numeric_limits<double>::is_iec559 && (sizeof(double)
 namespace Warping
 {
 
+  /**
+   * @brief Grid of 2D nodes. The computations run in double precision, the nodes are stored in single precision like
+   * the matrix texture the vertex shader samples, which halves the memory of every calibration.
+   */
   class Matrix
   {
     public:
@@ -32,14 +36,18 @@ namespace Warping
       uint32_t dimX() const { return mDimX; }
       uint32_t dimY() const { return mDimY; }
 
-      const float64_t* data() const { return mElements.data(); }
+      const float* data() const { return mElements.data(); }
+
+      std::array<float64_t, 2> sampleBilinear(float64_t x, float64_t y) const;
+      std::array<float64_t, 2> sampleBicubic(float64_t x, float64_t y) const;
+      std::array<uint32_t, 4> differingRegion(const Matrix& other) const;
 
       void getExtendedWarpingMatrix(const std::array<float64_t, 2>& viewResolution, Matrix& em);
 
     private:
       uint32_t mDimX;
       uint32_t mDimY;
-      std::vector<float64_t> mElements;
+      std::vector<float> mElements;
 
       void extrapolateLinear(Matrix& t);
   };
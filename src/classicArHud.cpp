@@ -12,33 +12,36 @@
 #include <core/renderviewport.h>
 #include <effect/effecthandler.h>
 #include <opengl/glframebuffer.h>
-#include <opengl/glshader.h>
-#include <opengl/glshadermanager.h>
 #include <opengl/gltexture.h>
 #include <opengl/glvertexbuffer.h>
 #include <wayland/display.h>
 #include <wayland/output.h>
 
 #include "warpingEffect.h"
+#include "offscreenTarget.h"
+#include "AdaptiveMeshBuilder.hxx"
 #include "MBitionWarpedOutput.h"
 #include "MBitionWarpedOutputManager.h"
+#include "ProtocolTrace.hxx"
 
+#include <algorithm>
 #include <memory>
 #include <QFile>
 #include <QJsonDocument>
+#include <QTimer>
 #include "kwinarhud_debug.h"
 
 namespace KWin
 {
 
-// TODO Make sure that wayland callbacks and paintScreen get called from the same threads
 ClassicArHudEffect::ClassicArHudEffect()
-    : m_shader(
-        ShaderManager::instance()->generateShaderFromFile(ShaderTrait::MapTexture,
-                                                          QStringLiteral(":/effects/arhud/shaders/warping_arhud_classic.vert"),
-                                                          QStringLiteral(":/effects/arhud/shaders/warping_arhud_classic.frag")))
+    : m_shaders(QStringLiteral(":/effects/arhud/shaders/warping_arhud_classic_core.vert"),
+                QStringLiteral(":/effects/arhud/shaders/warping_arhud_classic_core.frag"),
+                {QByteArray("SINGLE_MATRIX"), QByteArray("BICUBIC_INTERPOLATION"), QByteArray("FLOAT_MATRIX_TEXTURE")},
+                &ClassicArHudEffect::resolveShaderUniforms)
 {
-    if (!m_shader->isValid())
+    // The generic variant is valid for every frame.
+    if (!m_shaders.variant(0))
     {
         qCWarning(KWINARHUD_DEBUG) << "Shader is not valid!";
         return;
@@ -66,6 +69,33 @@ ClassicArHudEffect::ClassicArHudEffect()
             CONTENT_RESOLUTION_Y = obj[u"CONTENT_RESOLUTION_Y"].toInt();
             WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X = obj[u"WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X"].toInt();
             WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y = obj[u"WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y"].toInt();
+            const double meshMaxError = obj[u"MESH_MAX_ERROR_PIXELS"].toDouble(MESH_MAX_ERROR_PIXELS);
+            if (isValidMeshMaxErrorPixels(meshMaxError))
+            {
+                MESH_MAX_ERROR_PIXELS = static_cast<float>(meshMaxError);
+            }
+            else
+            {
+                qCWarning(KWINARHUD_DEBUG) << "Ignoring MESH_MAX_ERROR_PIXELS" << meshMaxError << "- it has to be 0 to" << MESH_MAX_ERROR_PIXELS_LIMIT;
+            }
+            const int meshMinSubdivision = obj[u"MESH_MIN_SUBDIVISION"].toInt(static_cast<int>(MESH_MIN_SUBDIVISION));
+            if (meshMinSubdivision >= 0 && isValidMeshMinSubdivision(static_cast<uint32_t>(meshMinSubdivision)))
+            {
+                MESH_MIN_SUBDIVISION = static_cast<uint32_t>(meshMinSubdivision);
+            }
+            else
+            {
+                qCWarning(KWINARHUD_DEBUG) << "Ignoring MESH_MIN_SUBDIVISION" << meshMinSubdivision << "- it has to be 0 to" << MESH_MIN_SUBDIVISION_LIMIT;
+            }
+            MESH_BICUBIC_INTERPOLATION = obj[u"MESH_BICUBIC_INTERPOLATION"].toBool(MESH_BICUBIC_INTERPOLATION);
+            CLASSIC_HUD_OFFSCREEN_FORMAT = obj[u"CLASSIC_HUD_OFFSCREEN_FORMAT"].toString(QString::fromStdString(CLASSIC_HUD_OFFSCREEN_FORMAT)).toStdString();
+            MINI_HUD_OFFSCREEN_FORMAT = obj[u"MINI_HUD_OFFSCREEN_FORMAT"].toString(QString::fromStdString(MINI_HUD_OFFSCREEN_FORMAT)).toStdString();
+            FRAME_BUDGET_MS = static_cast<float>(obj[u"FRAME_BUDGET_MS"].toDouble(FRAME_BUDGET_MS));
+            PERFORMANCE_OVERLAY = obj[u"PERFORMANCE_OVERLAY"].toBool(PERFORMANCE_OVERLAY);
+            OFFSCREEN_RING_DEPTH = static_cast<uint32_t>(obj[u"OFFSCREEN_RING_DEPTH"].toInt(static_cast<int>(OFFSCREEN_RING_DEPTH)));
+            WARP_ONLY_REPROJECTION = obj[u"WARP_ONLY_REPROJECTION"].toBool(WARP_ONLY_REPROJECTION);
+            PROTOCOL_TRACE_FILE = obj[u"PROTOCOL_TRACE_FILE"].toString(QString::fromStdString(PROTOCOL_TRACE_FILE)).toStdString();
+            DBUS_TUNING = obj[u"DBUS_TUNING"].toBool(DBUS_TUNING);
 
             qCInfo(KWINARHUD_DEBUG) << "Loaded warping constants from" << f.fileName();
         }
@@ -88,19 +118,97 @@ ClassicArHudEffect::ClassicArHudEffect()
     qCInfo(KWINARHUD_DEBUG) << "CONTENT_RESOLUTION_Y:" << CONTENT_RESOLUTION_Y;
     qCInfo(KWINARHUD_DEBUG) << "WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X:" << WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X;
     qCInfo(KWINARHUD_DEBUG) << "WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y:" << WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y;
+    qCInfo(KWINARHUD_DEBUG) << "MESH_MAX_ERROR_PIXELS:" << MESH_MAX_ERROR_PIXELS;
+    qCInfo(KWINARHUD_DEBUG) << "MESH_MIN_SUBDIVISION:" << MESH_MIN_SUBDIVISION;
+    qCInfo(KWINARHUD_DEBUG) << "MESH_BICUBIC_INTERPOLATION:" << MESH_BICUBIC_INTERPOLATION;
+    qCInfo(KWINARHUD_DEBUG) << "CLASSIC_HUD_OFFSCREEN_FORMAT:" << CLASSIC_HUD_OFFSCREEN_FORMAT.c_str();
+    qCInfo(KWINARHUD_DEBUG) << "MINI_HUD_OFFSCREEN_FORMAT:" << MINI_HUD_OFFSCREEN_FORMAT.c_str();
+    qCInfo(KWINARHUD_DEBUG) << "FRAME_BUDGET_MS:" << FRAME_BUDGET_MS;
+    qCInfo(KWINARHUD_DEBUG) << "PERFORMANCE_OVERLAY:" << PERFORMANCE_OVERLAY;
+    qCInfo(KWINARHUD_DEBUG) << "OFFSCREEN_RING_DEPTH:" << OFFSCREEN_RING_DEPTH;
+    qCInfo(KWINARHUD_DEBUG) << "WARP_ONLY_REPROJECTION:" << WARP_ONLY_REPROJECTION;
+    qCInfo(KWINARHUD_DEBUG) << "PROTOCOL_TRACE_FILE:" << PROTOCOL_TRACE_FILE.c_str();
+    qCInfo(KWINARHUD_DEBUG) << "DBUS_TUNING:" << DBUS_TUNING;
+
+    if (!PROTOCOL_TRACE_FILE.empty() && !ProtocolTraceWriter::instance())
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Could not open protocol trace file" << PROTOCOL_TRACE_FILE.c_str();
+    }
 
-    m_vertexCount = (WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X - 1) * (WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y - 1) * 6;
-
-    m_modelViewProjectioMatrixLocation  = m_shader->uniformLocation("modelViewProjectionMatrix");
-    m_warpingMatrixTextureLocation      = m_shader->uniformLocation("warpingMatrixTexture");
-    m_matrixCountLocation               = m_shader->uniformLocation("matrixCount");
-    m_matrixResolutionLocation          = m_shader->uniformLocation("matrixResolution");
-    m_matrixInterpolationFactorLocation = m_shader->uniformLocation("matrixInterpolationFactor");
-    m_matrixInterpolationIndexLocation  = m_shader->uniformLocation("matrixInterpolationIndex");
-    m_inputTextureLocation              = m_shader->uniformLocation("inputTexture");
-    m_uvFunctLocation                   = m_shader->uniformLocation("uvFunc");
+    m_governor.setBudget(std::chrono::microseconds(static_cast<int64_t>(FRAME_BUDGET_MS * 1000.0f)));
+    m_governor.setStatistics(&m_statistics);
+    m_offscreenFormat = offscreenFormatFromName(QString::fromStdString(CLASSIC_HUD_OFFSCREEN_FORMAT));
+    m_headPose = std::make_unique<HeadPoseBuffer>();
+    m_warpParameters = std::make_unique<WarpParametersBuffer>();
 
     m_warpedOutputManager = std::make_unique<MBitionWarpedOutputManager>(this);
+
+    // Same lookup as MBitionWarpedOutputManager, so that the screen prewarmed here is the one bound later.
+    if (Output* hudScreen = WarpingEffect::findHudScreen(DISPLAY_RESOLUTION_X, DISPLAY_RESOLUTION_Y))
+    {
+        prewarm(hudScreen);
+    }
+    else
+    {
+        qCInfo(KWINARHUD_DEBUG) << "No HUD screen at startup, GPU resources are allocated on first use";
+    }
+}
+
+void ClassicArHudEffect::prewarm(Output* screen)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // Every slot of the ring, the first frames would allocate them otherwise.
+    m_offscreen.setDepth(OFFSCREEN_RING_DEPTH);
+    for (uint32_t slot = 0; slot < m_offscreen.depth(); slot++)
+    {
+        checkGlTexture(screen);
+    }
+
+    // Every variant a frame can pick, the matrix texture format is only known after the first upload.
+    std::vector<uint32_t> keys;
+    for (uint32_t key = 0; key <= (SingleMatrix | BicubicInterpolation | FloatMatrixTexture); key++)
+    {
+        if ((key & BicubicInterpolation) && !MESH_BICUBIC_INTERPOLATION)
+        {
+            continue;
+        }
+        keys.push_back(key);
+    }
+    const std::vector<ShaderProgram*> programs = m_shaders.preload(keys);
+    // Every variant reads the HeadPose and WarpParameters blocks, they have to be backed by buffers for the draws.
+    m_headPose->bind();
+    m_warpParameters->bind();
+    prewarmPrograms(m_offscreen.framebuffer(), programs);
+
+    // Include the work the driver queued, it would otherwise land in the first frame.
+    glFinish();
+
+    m_prewarmDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    qCInfo(KWINARHUD_DEBUG) << "Prewarmed" << programs.size() << "shader variants and the offscreen target of"
+                            << screen->name() << "in" << m_prewarmDuration.count() / 1000.0 << "ms";
+}
+
+ClassicArHudEffect::ShaderUniforms ClassicArHudEffect::resolveShaderUniforms(ShaderProgram* shader)
+{
+    ShaderUniforms uniforms;
+    uniforms.warpingMatrixTextureLocation      = shader->uniformLocation("warpingMatrixTexture");
+    uniforms.inputTextureLocation              = shader->uniformLocation("inputTexture");
+    if (!shader->bindUniformBlock("HeadPose", HeadPoseBuffer::BINDING))
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Shader has no HeadPose uniform block";
+    }
+    if (!shader->bindUniformBlock("WarpParameters", WarpParametersBuffer::BINDING))
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Shader has no WarpParameters uniform block";
+    }
+
+    // The texture units never change, they are program state.
+    shader->bind();
+    shader->setUniform(uniforms.inputTextureLocation, 0);
+    shader->setUniform(uniforms.warpingMatrixTextureLocation, 1);
+    shader->unbind();
+    return uniforms;
 }
 
 ClassicArHudEffect::~ClassicArHudEffect() = default;
@@ -112,21 +220,51 @@ bool ClassicArHudEffect::isActive() const
 
 void ClassicArHudEffect::checkGlTexture(Output* screen)
 {
+    // The source rectangle and the uv function only depend on the output size and the constants.
     const QSize nativeSize = screen->geometry().size() * screen->scale();
-    if (!m_GLtexture || m_GLtexture->size() != nativeSize)
+    if (nativeSize != m_nativeSize)
     {
-        qCInfo(KWINARHUD_DEBUG) << "Init texture and framebuffer";
-        // If the texture doesn't exist or is of a different size, create a new one.
-        m_GLtexture = GLTexture::allocate(GL_RGBA8, nativeSize);
-        m_GLtexture->setFilter(GL_LINEAR);
-        m_GLtexture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_GLframebuffer.reset(new GLFramebuffer(m_GLtexture.get()));
+        m_nativeSize = nativeSize;
+
+        // Only the content area and the extrapolated border around it is sampled by the warp, see Warping::getUVFunc().
+        const std::array<float, 4> uvFunc = Warping::getUVFunc();
+        const QRectF uvRect(std::min(uvFunc[2], uvFunc[2] + uvFunc[0]),
+                            std::min(uvFunc[3], uvFunc[3] + uvFunc[1]),
+                            std::abs(uvFunc[0]),
+                            std::abs(uvFunc[1]));
+        m_sourceRect = sampledPixelRect(uvRect, nativeSize);
+
+        // Texture coordinates relative to the source rectangle.
+        const float width  = static_cast<float>(nativeSize.width());
+        const float height = static_cast<float>(nativeSize.height());
+        m_uvFunc = {{uvFunc[0] * width / static_cast<float>(m_sourceRect.width()),
+                     uvFunc[1] * height / static_cast<float>(m_sourceRect.height()),
+                     (uvFunc[2] * width - static_cast<float>(m_sourceRect.x())) / static_cast<float>(m_sourceRect.width()),
+                     (uvFunc[3] * height - static_cast<float>(m_sourceRect.y())) / static_cast<float>(m_sourceRect.height())}};
+    }
 
-        m_GLtexture->bind();
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        m_GLtexture->unbind();
+    // The slots follow a new size or format one by one as they come up again.
+    const QSize targetSize = scaledTargetSize(m_sourceRect, m_governor.renderScale());
+    m_offscreen.setDepth(OFFSCREEN_RING_DEPTH);
+    m_offscreen.acquire(m_offscreenFormat, targetSize, screen->refreshRate());
+    m_statistics.setOffscreenBytes(m_offscreen.bytes());
+}
+
+void ClassicArHudEffect::setOffscreenFormat(OffscreenFormat format)
+{
+    // Every slot of the ring is replaced when it is acquired next.
+    m_offscreenFormat = format;
+}
+
+QString ClassicArHudEffect::warpPathName(uint32_t path)
+{
+    QString name = (path & BicubicInterpolation) ? QStringLiteral("bicubic") : QStringLiteral("bilinear");
+    if (path & SingleMatrix)
+    {
+        name += QStringLiteral(", single matrix");
     }
+    name += (path & FloatMatrixTexture) ? QStringLiteral(", RG32F matrices") : QStringLiteral(", RGBA8 matrices");
+    return name;
 }
 
 MBitionWarpedOutput* ClassicArHudEffect::warpedOutput(Output* screen)
@@ -146,75 +284,194 @@ MBitionWarpedOutput* ClassicArHudEffect::warpedOutput(Output* screen)
     if (!m_warpedOutput)
     {
         qCInfo(KWINARHUD_DEBUG) << "Creating warping output for screen " << screen->name();
-        m_warpedOutput.reset(new MBitionWarpedOutput());
+        m_warpedOutput.reset(new MBitionWarpedOutput(this));
         checkGlTexture(screen);
     }
 
     return m_warpedOutput.get();
 }
 
-/**
- * @brief Generates a vertex buffer object (VBO) to run shader on it.
- * @return A pointer to the generated GLVertexBuffer.
- */
-static GLVertexBuffer* texturedRectVbo(const uint32_t vertexCount)
+void ClassicArHudEffect::headPositionChanged(const WarpPose& /*pose*/)
 {
-    // Create a streaming buffer for the VBO and reset it.
-    GLVertexBuffer* vbo = GLVertexBuffer::streamingBuffer();
-    if (!vbo)
+    m_statistics.poseReceived();
+
+    // Not latched into the frame submitted last: the GPU may already be running its draw, and vertices of the same
+    // draw would read different poses.
+}
+
+void ClassicArHudEffect::latchHeadPose(const WarpPose& pose, bool singleMatrix)
+{
+    int32_t index  = pose.matrixIndex;
+    float   factor = pose.matrixFactor;
+
+    if (singleMatrix)
     {
-        qCWarning(KWINARHUD_DEBUG) << "texturedRectVbo failed: GLVertexBuffer::streamingBuffer() returned nullptr";
-        return vbo;
+        // The variant reads the matrix at the index only, a factor of 1 selects the next one.
+        if (factor >= 0.5f)
+        {
+            index++;
+        }
+        factor = 0.0f;
     }
-    vbo->reset();
+    m_headPose->write(index, factor);
+}
 
-    // Define vertex attribute layout.
-    const GLVertexAttrib attribs[] = {
-        {VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position)},
-        {VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord)},
-    };
-    vbo->setAttribLayout(attribs, sizeof(GLVertex2D));
+void ClassicArHudEffect::matricesChanged(const WarpCalibration& calibration)
+{
+    updateMesh(calibration);
+}
 
-    const auto opt = vbo->map<GLVertex2D>(vertexCount);
-    if (!opt) {
-        return nullptr;
+std::vector<std::array<float, 2>> ClassicArHudEffect::cullOutsideContent(const std::vector<std::array<float, 2>>& texcoords)
+{
+    // Content area in the texture coordinates of the display area, which the uv function maps the grid into.
+    const std::array<float, 4> uvFunc = Warping::getUVFunc();
+    const float displayX = static_cast<float>(DISPLAY_RESOLUTION_X);
+    const float displayY = static_cast<float>(DISPLAY_RESOLUTION_Y);
+    const float contentX = static_cast<float>(CONTENT_RESOLUTION_X);
+    const float contentY = static_cast<float>(CONTENT_RESOLUTION_Y);
+    const float left = (displayX - contentX) / 2.0f / displayX;
+    const float right = (displayX + contentX) / 2.0f / displayX;
+    const float top = (displayY - contentY) / 2.0f / displayY;
+    const float bottom = (displayY + contentY) / 2.0f / displayY;
+
+    std::vector<std::array<float, 2>> kept;
+    kept.reserve(texcoords.size());
+    for (size_t index = 0; index + 2 < texcoords.size(); index += 3)
+    {
+        float minU = 1.0f, minV = 1.0f, maxU = 0.0f, maxV = 0.0f;
+        for (size_t vertex = index; vertex < index + 3; vertex++)
+        {
+            const float u = texcoords[vertex][0] * uvFunc[0] + uvFunc[2];
+            const float v = texcoords[vertex][1] * uvFunc[1] + uvFunc[3];
+            minU = std::min(minU, u);
+            maxU = std::max(maxU, u);
+            minV = std::min(minV, v);
+            maxV = std::max(maxV, v);
+        }
+        // Triangles of the extrapolated border that lie completely outside only sample the black surrounding.
+        if (maxU <= left || minU >= right || maxV <= top || minV >= bottom)
+        {
+            continue;
+        }
+        kept.insert(kept.end(), texcoords.begin() + index, texcoords.begin() + index + 3);
     }
-    const auto map = *opt;
+    return kept;
+}
 
-    // Define UV coordinates and step size for texturing.
-    constexpr auto uv       = std::array<float, 4>{{1.0f, 1.0f, 0.0, 0.0}};
-    QVector2D  stepTexcoord = {uv[0] / float(WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X - 1),
-                               uv[1] / float(WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y - 1)};
+bool ClassicArHudEffect::isMeshCurrent(const WarpCalibration& calibration) const
+{
+    const bool bicubic = MESH_BICUBIC_INTERPOLATION && m_governor.allowBicubicInterpolation();
+    return m_mesh && m_meshGeneration == calibration.generation
+           && m_meshMaxError == m_governor.meshMaxErrorPixels(MESH_MAX_ERROR_PIXELS)
+           && m_meshMinSubdivision == MESH_MIN_SUBDIVISION && m_meshBicubic == bicubic;
+}
 
-    // Generate vertices for the grid of rectangles.
-    for (uint32_t x = 0; x < (WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X - 1); ++x)
+void ClassicArHudEffect::scheduleQualityUpdate()
+{
+    if (m_qualityUpdatePending)
     {
-        for (uint32_t y = 0; y < (WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y - 1); ++y)
+        return;
+    }
+    m_qualityUpdatePending = true;
+
+    QTimer::singleShot(0, this, [this]() {
+        m_qualityUpdatePending = false;
+        if (!m_warpedOutput || !effects->makeOpenGLContextCurrent())
+        {
+            return;
+        }
+        if (const std::shared_ptr<const WarpCalibration> calibration = m_warpedOutput->state().calibration)
+        {
+            updateMesh(*calibration);
+        }
+        if (m_warpedScreen && m_nativeSize.isValid())
         {
-            const uint32_t start = x * (WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y - 1) * 6 + y * 6;
-
-            QVector2D orig        = {uv[2] + static_cast<float>(x) * stepTexcoord.x(),
-                                     uv[3] + static_cast<float>(y) * stepTexcoord.y()};
-            QVector2D texcoord_00 = orig;
-            QVector2D texcoord_01 = orig + QVector2D(0, 1) * stepTexcoord;
-            QVector2D texcoord_10 = orig + QVector2D(1, 0) * stepTexcoord;
-            QVector2D texcoord_11 = orig + QVector2D(1, 1) * stepTexcoord;
-
-            // Define vertices for two triangles forming a rectangle.
-            // First triangle
-            map[start + 0] = GLVertex2D{.position = QVector2D(0, 0), .texcoord = texcoord_01};
-            map[start + 1] = GLVertex2D{.position = QVector2D(0, 0), .texcoord = texcoord_10};
-            map[start + 2] = GLVertex2D{.position = QVector2D(0, 0), .texcoord = texcoord_00};
-            // Second triangle
-            map[start + 3] = GLVertex2D{.position = QVector2D(0, 0), .texcoord = texcoord_01};
-            map[start + 4] = GLVertex2D{.position = QVector2D(0, 0), .texcoord = texcoord_11};
-            map[start + 5] = GLVertex2D{.position = QVector2D(0, 0), .texcoord = texcoord_10};
+            m_offscreen.prepare(m_offscreenFormat, scaledTargetSize(m_sourceRect, m_governor.renderScale()),
+                                m_warpedScreen->refreshRate());
+            m_statistics.setOffscreenBytes(m_offscreen.bytes());
         }
+    });
+}
+
+void ClassicArHudEffect::updateMesh(const WarpCalibration& calibration)
+{
+    if (isMeshCurrent(calibration))
+    {
+        return;
     }
+    const float maxError = m_governor.meshMaxErrorPixels(MESH_MAX_ERROR_PIXELS);
+    const bool  bicubic  = MESH_BICUBIC_INTERPOLATION && m_governor.allowBicubicInterpolation();
+
+    // The mesh has to approximate the warp of every matrix, the interpolated warps then stay within the bound too.
+    AdaptiveMeshBuilder builder(calibration.resolutionX - 1, calibration.resolutionY - 1);
+    builder.setMaxErrorPixels(maxError);
+    builder.setMinSubdivision(MESH_MIN_SUBDIVISION);
+    for (const std::shared_ptr<const Matrix>& pointer : calibration.matrices)
+    {
+        const Matrix& matrix = *pointer;
+        // Same interpolation as the vertex shader, so the error is measured against what is drawn.
+        builder.addSurface([&matrix, bicubic](float64_t x, float64_t y) {
+            const std::array<float64_t, 2> ssPos = bicubic ? matrix.sampleBicubic(x, y) : matrix.sampleBilinear(x, y);
+            return std::array<float64_t, 2>{{(ssPos[0] + 1.0) * 0.5 * DISPLAY_RESOLUTION_X,
+                                             (ssPos[1] + 1.0) * 0.5 * DISPLAY_RESOLUTION_Y}};
+        });
+    }
+
+    MeshStatistics statistics;
+    const std::vector<std::array<float, 2>> texcoords = cullOutsideContent(builder.build(statistics));
 
-    // Unmap the VBO memory and return the generated VBO.
-    vbo->unmap();
-    return vbo;
+    // Screen-space bounds of the kept triangles under every matrix, the warp pass is scissored to them.
+    m_matrixBounds.clear();
+    m_matrixBounds.reserve(calibration.matrices.size());
+    for (const std::shared_ptr<const Matrix>& pointer : calibration.matrices)
+    {
+        const Matrix& matrix = *pointer;
+        float64_t minX = 1.0, minY = 1.0, maxX = -1.0, maxY = -1.0;
+        for (const std::array<float, 2>& texcoord : texcoords)
+        {
+            const float64_t x = texcoord[0] * static_cast<float64_t>(calibration.resolutionX - 1);
+            const float64_t y = texcoord[1] * static_cast<float64_t>(calibration.resolutionY - 1);
+            const std::array<float64_t, 2> ssPos = bicubic ? matrix.sampleBicubic(x, y) : matrix.sampleBilinear(x, y);
+            // The vertex shader flips y into normalized device coordinates.
+            minX = std::min(minX, ssPos[0]);
+            maxX = std::max(maxX, ssPos[0]);
+            minY = std::min(minY, -ssPos[1]);
+            maxY = std::max(maxY, -ssPos[1]);
+        }
+        m_matrixBounds.emplace_back(QPointF(minX, minY), QPointF(maxX, maxY));
+    }
+
+    if (!m_mesh)
+    {
+        m_mesh = std::make_unique<GLVertexBuffer>(GLVertexBuffer::UsageHint::Static);
+        // The vertex shader looks the position up in the warping matrices.
+        const GLVertexAttrib attribs[] = {
+            {VA_TexCoord, 2, GL_FLOAT, 0},
+        };
+        m_mesh->setAttribLayout(attribs, sizeof(std::array<float, 2>));
+    }
+
+    const auto map = m_mesh->map<std::array<float, 2>>(texcoords.size());
+    if (!map)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "updateMesh failed: GLVertexBuffer::map() returned nullptr";
+        m_mesh.reset();
+        m_vertexCount = 0;
+        return;
+    }
+    std::copy(texcoords.begin(), texcoords.end(), map->begin());
+    m_mesh->unmap();
+
+    m_vertexCount = static_cast<uint32_t>(texcoords.size());
+    m_meshStatistics = statistics;
+    m_meshGeneration = calibration.generation;
+    m_meshMaxError = maxError;
+    m_meshMinSubdivision = MESH_MIN_SUBDIVISION;
+    m_meshBicubic = bicubic;
+
+    qCInfo(KWINARHUD_DEBUG) << "Warp mesh:" << statistics.quadCount << "quads," << m_vertexCount << "of"
+                            << statistics.vertexCount << "vertices inside the content, estimated error"
+                            << statistics.estimatedErrorPixels << "px";
 }
 
 void ClassicArHudEffect::paintScreen(const RenderTarget &renderTarget, const RenderViewport &viewport, int mask, const QRegion &region, Output *screen)
@@ -226,74 +483,188 @@ void ClassicArHudEffect::paintScreen(const RenderTarget &renderTarget, const Ren
     }
 
     // Check if the screen is being warped, if not, skip the effect.
-    if (screen != m_warpedScreen || !m_warpedOutput || !m_warpedOutput->isInitialized())
+    if (screen != m_warpedScreen || !m_warpedOutput)
+    {
+        if (screen == m_warpedScreen)
+        {
+            m_scissor.invalidate();
+        }
+        effects->paintScreen(renderTarget, viewport, mask, region, screen);
+        return;
+    }
+
+    const auto frameStart = std::chrono::steady_clock::now();
+
+    // The frame uses one calibration and the pose published with it throughout, recalibrations published meanwhile
+    // apply to the next frame.
+    const WarpState state = m_warpedOutput->state();
+    const std::shared_ptr<const WarpCalibration>& calibration = state.calibration;
+    if (!calibration)
     {
+        m_statistics.frameSkipped();
+        m_scissor.invalidate();
         effects->paintScreen(renderTarget, viewport, mask, region, screen);
         return;
     }
 
-    // Render the screen in an offscreen texture.
-    checkGlTexture(screen);
-    if (!m_GLframebuffer)
+    if (!m_headPose->isValid())
     {
-        // if there is some problems with framebuffer, skip the effect
-        qCWarning(KWINARHUD_DEBUG) << "paintScreen failed: framebuffer of screen is nullptr";
+        qCWarning(KWINARHUD_DEBUG) << "paintScreen failed: no head pose buffer";
+        m_statistics.frameSkipped();
+        m_scissor.invalidate();
         effects->paintScreen(renderTarget, viewport, mask, region, screen);
         return;
     }
 
-    GLFramebuffer::pushFramebuffer(m_GLframebuffer.get());
-    effects->paintScreen(renderTarget, viewport, mask, region, screen);
-    GLFramebuffer::popFramebuffer();
+    m_governor.beginFrame();
+
+    // Without damage on the HUD only the pose moved, the last offscreen target is warped again.
+    if (!PERFORMANCE_OVERLAY && m_overlay.takeDrawn())
+    {
+        // The last offscreen target still shows the overlay that got switched off.
+        m_sceneDamage.invalidate();
+    }
+    const bool damaged = m_sceneDamage.takeDamage(screen->geometry());
+    const bool reproject = WARP_ONLY_REPROJECTION && !damaged
+                           && m_offscreen.isReusable(m_offscreenFormat, scaledTargetSize(m_sourceRect, m_governor.renderScale()));
+    if (!reproject)
+    {
+        // Render the screen in an offscreen texture.
+        checkGlTexture(screen);
+        if (!m_offscreen.framebuffer())
+        {
+            // if there is some problems with framebuffer, skip the effect
+            qCWarning(KWINARHUD_DEBUG) << "paintScreen failed: framebuffer of screen is nullptr";
+            m_statistics.frameSkipped();
+            m_sceneDamage.invalidate();
+            m_governor.endFrame();
+            m_scissor.invalidate();
+            effects->paintScreen(renderTarget, viewport, mask, region, screen);
+            return;
+        }
+
+        paintScreenArea(m_offscreen.framebuffer(), m_sourceRect, m_governor.renderScale(), renderTarget, viewport, mask, region, screen, m_regionCache);
+    }
+    if (PERFORMANCE_OVERLAY)
+    {
+        // Reprojected frames draw it again into the target they reuse, the opaque panel covers the previous values.
+        m_overlay.draw(m_offscreen.framebuffer(), m_statistics, m_governor);
+    }
+    const auto warpStart = std::chrono::steady_clock::now();
+
+    const float factor = state.pose.matrixFactor;
 
-    // Projection matrix + rotate transform.
-    const QMatrix4x4 modelViewProjectionMatrix(viewport.projectionMatrix());
+    if (!m_mesh || m_meshGeneration != calibration->generation)
+    {
+        // Nothing valid to draw otherwise, normally the handler of the calibration built it already.
+        updateMesh(*calibration);
+    }
+    else if (!isMeshCurrent(*calibration))
+    {
+        // A changed tolerance only refines the mesh, the current one is drawn until the rebuild after this frame.
+        scheduleQualityUpdate();
+    }
+
+    // Pick the cheapest shader variant valid for this frame.
+    uint32_t key = calibration->textureFormat == GL_RG32F ? uint32_t{FloatMatrixTexture} : 0u;
+    if (calibration->matrixCount == 1 || factor == 0.0f || factor == 1.0f)
+    {
+        key |= SingleMatrix;
+    }
+    if (m_meshBicubic)
+    {
+        key |= BicubicInterpolation;
+    }
+    auto variant = m_shaders.variant(key);
+    if (!variant && (key & BicubicInterpolation))
+    {
+        key &= ~BicubicInterpolation;
+        variant = m_shaders.variant(key);
+    }
+    if (!variant)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "paintScreen failed: no valid shader variant" << key;
+        m_statistics.frameSkipped();
+        // The slot was acquired for this frame, fence it like after a warp so that the ring stays in step.
+        m_offscreen.release();
+        m_governor.endFrame();
+        m_scissor.invalidate();
+        effects->paintScreen(renderTarget, viewport, mask, region, screen);
+        effects->addRepaint(screen->geometry());
+        return;
+    }
+    const bool singleMatrix = key & SingleMatrix;
+    m_statistics.setWarpPath(key);
+    ShaderProgram* shader = variant->shader.get();
 
     glActiveTexture(GL_TEXTURE0);
-    m_GLtexture->bind();
+    m_offscreen.texture()->setFilter(m_governor.textureFilter());
+    m_offscreen.texture()->bind();
 
-    // Clear the background.
-    glClearColor(0, 0, 0, 0);
-    glClear(GL_COLOR_BUFFER_BIT);
+    // Clear the background and restrict the draw to where the mesh lands. The late latch below may still move to a
+    // neighbouring matrix pair, so their bounds are covered too.
+    QRectF bounds;
+    if (!m_matrixBounds.empty())
+    {
+        const int32_t index = state.pose.matrixIndex;
+        const int32_t last = static_cast<int32_t>(m_matrixBounds.size()) - 1;
+        for (int32_t matrix = std::clamp(index - 1, 0, last); matrix <= std::clamp(index + 2, 0, last); matrix++)
+        {
+            bounds = bounds.united(m_matrixBounds[matrix]);
+        }
+    }
+    m_scissor.begin(bounds);
 
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_warpedOutput->m_texture);
-
-    int32_t index;
-    float   factor;
-    m_warpedOutput->m_matrixInterpolationModel.getInterpolationParameters(index, factor);
-
-    ShaderManager* sm = ShaderManager::instance();
-    sm->pushShader(m_shader.get());
-    m_shader->setUniform(m_modelViewProjectioMatrixLocation, modelViewProjectionMatrix);
-    m_shader->setUniform(m_inputTextureLocation, 0);
-    m_shader->setUniform(m_warpingMatrixTextureLocation, 1);
-    m_shader->setUniform(m_matrixCountLocation, int(Warping::WARPING_MATRIX_COUNT));
-    m_shader->setUniform(m_matrixResolutionLocation,
-                         {float(WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X), float(WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y)});
-    m_shader->setUniform(m_matrixInterpolationFactorLocation, factor);
-    m_shader->setUniform(m_matrixInterpolationIndexLocation, index);
-    std::array<float, 4> uvFunc = Warping::getUVFunc();
-    m_shader->setUniform(m_uvFunctLocation, QVector4D(uvFunc[0], uvFunc[1], uvFunc[2], uvFunc[3]));
-
-    GLVertexBuffer* vbo = texturedRectVbo(m_vertexCount);
-    if (vbo)
-    {
-        vbo->bindArrays();
-        vbo->draw(GL_TRIANGLES, 0, m_vertexCount);
-        vbo->unbindArrays();
+    glBindTexture(GL_TEXTURE_2D, calibration->texture);
+
+    // The samplers are set when the variant is linked, the remaining parameters only change with the offscreen target
+    // or a recalibration.
+    shader->bind();
+    m_warpParameters->update(m_uvFunc, calibration->resolutionX, calibration->resolutionY);
+    m_warpParameters->bind();
+
+    if (m_mesh)
+    {
+        // The scene pass above takes most of the frame, so the pose is read again right before the draw. A pose of a
+        // newer calibration waits for the next frame, and so does any pose in a frame whose variant was picked for a
+        // pose at a matrix: it would jump a whole matrix instead of blending.
+        const WarpState& latest = m_warpedOutput->state();
+        const bool latchLatest = !singleMatrix && latest.pose.generation == calibration->generation;
+        m_headPose->nextFrame();
+        latchHeadPose(latchLatest ? latest.pose : state.pose, singleMatrix);
+        m_headPose->bind();
+
+        m_mesh->bindArrays();
+        m_mesh->draw(GL_TRIANGLES, 0, m_vertexCount);
+        m_mesh->unbindArrays();
+        m_headPose->release();
     }
     else
     {
-        qCWarning(KWINARHUD_DEBUG) << "paintScreen failed: texturedRectVbo() returned nullptr";
+        qCWarning(KWINARHUD_DEBUG) << "paintScreen failed: no warp mesh";
     }
 
-    sm->popShader();
+    shader->unbind();
+    m_scissor.end();
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    m_GLtexture->unbind();
+    m_offscreen.texture()->unbind();
+    m_offscreen.release();
+
+    const auto frameEnd = std::chrono::steady_clock::now();
+    m_statistics.frameRendered(frameEnd - frameStart, frameEnd - warpStart);
+    if (reproject)
+    {
+        m_statistics.frameReprojected();
+    }
+
+    if (m_governor.endFrame())
+    {
+        scheduleQualityUpdate();
+    }
 
     // TODO: Could be transformed with the rendering
     effects->addRepaint(screen->geometry());
@@ -5,10 +5,23 @@
 
 #include <effect/effect.h>
 
+#include "frameBudgetGovernor.h"
+#include "headPoseBuffer.h"
+#include "offscreenTarget.h"
+#include "performanceOverlay.h"
+#include "sceneDamageTracker.h"
+#include "shaderVariants.h"
+#include "warpParametersBuffer.h"
+#include "warpScissor.h"
+#include "warpState.h"
+#include "warpingStatistics.h"
+#include "AdaptiveMeshBuilder.hxx"
 #include "MatrixTextureModel.hxx"
 #include "WarpingMatrixInterpolationModel.hxx"
 #include "WarpingUtils.hxx"
 
+#include <array>
+#include <chrono>
 #include <memory>
 
 class MBitionWarpedOutput;
@@ -18,8 +31,8 @@ namespace KWin
 {
 
 class GLFramebuffer;
-class GLShader;
 class GLTexture;
+class GLVertexBuffer;
 
 class WarpingEffect;
 
@@ -44,25 +57,116 @@ public:
     void checkGlTexture(Output* screen);
     MBitionWarpedOutput* warpedOutput(Output* screen);
 
+    /**
+     * @brief Called once a new calibration is published, builds its mesh ahead of the next frame.
+     */
+    void matricesChanged(const WarpCalibration& calibration);
+
+    /**
+     * @brief Called for every published head pose, the next frame reads it right before its draw.
+     */
+    void headPositionChanged(const WarpPose& pose);
+
+    /**
+     * @brief Time the prewarm of the GPU resources took, zero if the HUD screen was not known at startup.
+     */
+    std::chrono::microseconds prewarmDuration() const { return m_prewarmDuration; }
+
+    WarpingStatistics& statistics() { return m_statistics; }
+    const FrameBudgetGovernor& governor() const { return m_governor; }
+
+    /**
+     * @brief Describes a warp path recorded in the statistics, see ShaderFeature.
+     */
+    static QString warpPathName(uint32_t path);
+
+    /**
+     * @brief Requested format of the offscreen target, a change reallocates it in the next frame.
+     */
+    OffscreenFormat offscreenFormat() const { return m_offscreenFormat; }
+    void setOffscreenFormat(OffscreenFormat format);
+
 private:
-    uint32_t m_vertexCount = 0;
+    /**
+     * @brief Allocates the offscreen target and loads and draws every shader variant once, so that the first
+     * warped frame does not pay for it.
+     */
+    void prewarm(Output* screen);
+
+    /**
+     * @brief Rebuilds the adaptively tessellated warp mesh when the calibration changed.
+     *
+     * The rebuild allocates. It runs in the calibration handler and after a frame, and in paintScreen() only while
+     * there is no mesh for the calibration of the frame yet.
+     */
+    void updateMesh(const WarpCalibration& calibration);
+    bool isMeshCurrent(const WarpCalibration& calibration) const;
+
+    /**
+     * @brief Applies a new governor tier or mesh setting after the frame: rebuilds the mesh and reallocates the
+     * offscreen targets that are not in use, instead of doing either inside paintScreen().
+     */
+    void scheduleQualityUpdate();
+
+    /**
+     * @brief Drops the triangles that lie completely outside the content area of the display.
+     */
+    static std::vector<std::array<float, 2>> cullOutsideContent(const std::vector<std::array<float, 2>>& texcoords);
 
-    std::unique_ptr<GLTexture>                  m_GLtexture;
-    std::unique_ptr<GLFramebuffer>              m_GLframebuffer;
+    /**
+     * @brief Writes the interpolation parameters of the pose into the head pose buffer of the frame.
+     * @param[in] singleMatrix - Whether the shader variant of the frame ignores the interpolation factor
+     */
+    void latchHeadPose(const WarpPose& pose, bool singleMatrix);
+
+    uint32_t m_vertexCount = 0;
+    uint32_t m_meshGeneration = 0;
+    float m_meshMaxError = 0.0f;
+    uint32_t m_meshMinSubdivision = 0;
+    bool m_meshBicubic = false;
+    bool m_qualityUpdatePending = false;
+    Warping::MeshStatistics m_meshStatistics;
+    std::unique_ptr<GLVertexBuffer> m_mesh;
+    // Bounds of the mesh in normalized device coordinates under every matrix of the calibration.
+    std::vector<QRectF> m_matrixBounds;
+    WarpScissor m_scissor;
+
+    // Output size and the part of it rendered into the offscreen targets in device pixels, with the texture coordinate
+    // transformation into that part.
+    QSize                                       m_nativeSize;
+    QRect                                       m_sourceRect;
+    ClippedRegionCache                          m_regionCache;
+    std::array<float, 4>                        m_uvFunc = {{1.0f, 1.0f, 0.0f, 0.0f}};
+    FrameBudgetGovernor                         m_governor{QStringLiteral("Classic HUD")};
+    WarpingStatistics                           m_statistics;
+    PerformanceOverlay                          m_overlay;
+    OffscreenFormat                             m_offscreenFormat = OffscreenFormat::RGBA8;
+    OffscreenRing                               m_offscreen;
+    SceneDamageTracker                          m_sceneDamage;
+    std::unique_ptr<HeadPoseBuffer>             m_headPose;
+    std::unique_ptr<WarpParametersBuffer>       m_warpParameters;
     std::unique_ptr<MBitionWarpedOutput>        m_warpedOutput;
     std::unique_ptr<MBitionWarpedOutputManager> m_warpedOutputManager;
 
     Output* m_warpedScreen = nullptr;
-    std::unique_ptr<GLShader> m_shader;
-
-    int m_modelViewProjectioMatrixLocation  = -1;
-    int m_warpingMatrixTextureLocation      = -1;
-    int m_matrixCountLocation               = -1;
-    int m_matrixResolutionLocation          = -1;
-    int m_matrixInterpolationFactorLocation = -1;
-    int m_matrixInterpolationIndexLocation  = -1;
-    int m_inputTextureLocation              = -1;
-    int m_uvFunctLocation                   = -1;
+    std::chrono::microseconds m_prewarmDuration{0};
+
+    // Set once per variant, the other parameters are in the uniform blocks.
+    struct ShaderUniforms
+    {
+        int warpingMatrixTextureLocation      = -1;
+        int inputTextureLocation              = -1;
+    };
+    static ShaderUniforms resolveShaderUniforms(ShaderProgram* shader);
+
+    // Bits of the shader variant key, see warping_arhud_classic_core.vert.
+    enum ShaderFeature : uint32_t
+    {
+        SingleMatrix         = 1 << 0,
+        BicubicInterpolation = 1 << 1,
+        FloatMatrixTexture   = 1 << 2,
+    };
+    ShaderVariantCache<ShaderUniforms> m_shaders;
 };
 
 }  // namespace KWin
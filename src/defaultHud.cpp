@@ -7,15 +7,15 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <cerrno>
+#include <cmath>
 #include <cstring>
 
 #include "defaultHud.h"
 #include "warpingEffect.h"
+#include "offscreenTarget.h"
 #include "kwinarhud_debug.h"
 
-#include <opengl/glshader.h>
 #include <opengl/glvertexbuffer.h>
-#include <opengl/glshadermanager.h>
 #include <opengl/gltexture.h>
 #include <opengl/glframebuffer.h>
 #include <effect/effecthandler.h>
@@ -25,120 +25,112 @@
 
 #include "MBitionMiniHudWarping.h"
 #include "MBitionMiniHudWarpingManager.h"
+#include "WarpingConstants.hxx"
 
 #include <QVector4D>
 #include <QMatrix4x4>
 #include <algorithm>
 #include <QFile>
 #include <QString>
+#include <QTimer>
 
 struct ShaderRegion
 {
-    std::unique_ptr<KWin::GLVertexBuffer> m_vbo;
-    QMatrix4x4 params1_x;
-    QMatrix4x4 params1_y;
-    QMatrix4x4 params2_x;
-    QMatrix4x4 params2_y;
-    QMatrix4x4 params3_x;
-    QMatrix4x4 params3_y;
+    uint32_t x;
+    uint32_t y;
     QVector4D uv_span;
 
-    ShaderRegion(uint32_t x, uint32_t y, const QVector4D& uvspan, const params_t& params1,  const params_t& params2, const params_t& params3)
-        : m_vbo{ std::make_unique<KWin::GLVertexBuffer>(KWin::GLVertexBuffer::UsageHint::Static) }
-        , params1_x{ getMatrix(x, y, 0, params1) }
-        , params1_y{ getMatrix(x, y, 1, params1) }
-        , params2_x{ getMatrix(x, y, 0, params2) }
-        , params2_y{ getMatrix(x, y, 1, params2) }
-        , params3_x{ getMatrix(x, y, 0, params3) }
-        , params3_y{ getMatrix(x, y, 1, params3) }
+    ShaderRegion(uint32_t x, uint32_t y, const QVector4D& uvspan, const std::vector<params_t>& params)
+        : x{ x }
+        , y{ y }
         , uv_span{ uvspan }
     {
-        setupVBO();
-
-        const std::array<const QMatrix4x4*, 6> params = { &params1_x, &params1_y, &params2_x, &params2_y, &params3_x, &params3_y };
-        for (int i = 0; i < 6; i++) {
+        // Regions are rebuilt on governor tier changes as well, formatting the dump is only worth it when it is shown.
+        if (!KWINARHUD_DEBUG().isDebugEnabled()) {
+            return;
+        }
+        for (size_t i = 0; i < params.size() * 2; i++) {
             QString buffer;
             buffer.reserve(256);
             QTextStream logStream(&buffer);
             logStream << "[";
-            const float* p = params[i]->data();
-            for (int j = 0; j < 16; j++) {
-                logStream << p[i] << ", ";
+            for (uint32_t j = 0; j < control_points * control_points; j++) {
+                logStream << params[i / 2][parameterIndex(j / control_points, j % control_points, i % 2)] << ", ";
             }
             logStream << "]";
-            qCInfo(KWINARHUD_DEBUG) << "region:" << x << " " << y << "| params:" << (i / 2 + 1) << (i % 2 ? "y" : "x") << *logStream.string();
+            qCDebug(KWINARHUD_DEBUG) << "region:" << x << " " << y << "| params:" << (i / 2 + 1) << (i % 2 ? "y" : "x") << *logStream.string();
         }
     }
 
-    ShaderRegion(ShaderRegion&& other)
-        : m_vbo{ std::move(other.m_vbo) }
-        , params1_x{ other.params1_x }
-        , params1_y{ other.params1_y }
-        , params2_x{ other.params2_x }
-        , params2_y{ other.params2_y }
-        , params3_x{ other.params3_x }
-        , params3_y{ other.params3_y }
-        , uv_span{ other.uv_span }
-    {}
-
-    QMatrix4x4 getMatrix(uint32_t x, uint32_t y, uint32_t t, const std::array<float, 378>& a)
+    /**
+     * Index of the t-th coordinate (0 = x, 1 = y) of the control point (column, row) of this region
+     * in the 21x9 grid of interleaved x/y values sent by the client.
+     */
+    uint32_t parameterIndex(uint32_t column, uint32_t row, uint32_t t) const
     {
         const uint32_t s = 42;
-        const uint32_t p = 2 * x + s * y + t;
-        return QMatrix4x4{
-            a[p],         a[p + 2],         a[p + 4],         a[p + 6],
-            a[p + s],     a[p + s + 2],     a[p + s + 4],     a[p + s + 6],
-            a[p + 2 * s], a[p + 2 * s + 2], a[p + 2 * s + 4], a[p + 2 * s + 6],
-            a[p + 3 * s], a[p + 3 * s + 2], a[p + 3 * s + 4], a[p + 3 * s + 6]
-        };
+        return 2 * (x + column) + s * (y + row) + t;
+    }
+
+    /**
+     * Writes this region into one row of the region parameter texture: the uv span in texel 0,
+     * followed by one texel per control point and calibrated level holding (x, y) in rg.
+     */
+    void pack(float* row, const std::vector<params_t>& params) const
+    {
+        row[0] = uv_span.x();
+        row[1] = uv_span.y();
+        row[2] = uv_span.z();
+        row[3] = uv_span.w();
+
+        const size_t levels = params.size();
+        for (uint32_t column = 0; column < control_points; column++) {
+            for (uint32_t r = 0; r < control_points; r++) {
+                const uint32_t p = parameterIndex(column, r, 0);
+                for (size_t level = 0; level < levels; level++) {
+                    float* texel = row + 4 * (1 + (column * control_points + r) * levels + level);
+                    texel[0] = params[level][p];
+                    texel[1] = params[level][p + 1];
+                    texel[2] = 0.0f;
+                    texel[3] = 0.0f;
+                }
+            }
+        }
     }
 
-    void setupVBO()
+    static uint32_t texelsPerRegion(size_t levels)
+    {
+        // uv span + one texel per control point and level
+        return static_cast<uint32_t>(1 + control_points * control_points * levels);
+    }
+
+    static void setupVBO(KWin::GLVertexBuffer* vbo, uint32_t cells)
     {
         // Shader attribute layout
         const KWin::GLVertexAttrib attribs[] = {
             { KWin::VA_Position, 2, GL_FLOAT, offsetof(KWin::GLVertex2D, position) }
         };
-        m_vbo->setAttribLayout(attribs, sizeof(KWin::GLVertex2D));
+        vbo->setAttribLayout(attribs, sizeof(KWin::GLVertex2D));
 
-        const auto map_ptr = m_vbo->map<KWin::GLVertex2D>(vertexDimensions);
+        const uint32_t vertexCount = cells * cells * 6;
+        const auto map_ptr = vbo->map<KWin::GLVertex2D>(vertexCount);
         if (!map_ptr) {
             qCWarning(KWINARHUD_DEBUG) << "setupVBO failed - GLVertexBuffer::map() returned nullptr!";
             return;
         }
         const auto map = *map_ptr;
 
-        // Define triangles
-        uint32_t t = 0;
-        QVector2D step = { 1.f / region_width, 1.f / region_height };
-        for (uint32_t i = 0; i < region_width; i++) {
-            for (uint32_t j = 0; j < region_height; j++) {
-                QVector2D top_left =     {  i      * step.x(),  j      * step.y() };
-                QVector2D top_right =    { (i + 1) * step.x(),  j      * step.y() };
-                QVector2D bottom_left =  {  i      * step.x(), (j + 1) * step.y() };
-                QVector2D bottom_right = { (i + 1) * step.x(), (j + 1) * step.y() };
-
-                // First triangle
-                map[t++].position = top_left;
-                map[t++].position = bottom_left;
-                map[t++].position = top_right;
-
-                // Second triangle
-                map[t++].position = top_right;
-                map[t++].position = bottom_left;
-                map[t++].position = bottom_right;
-            }
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            const std::array<float, 2> unit = MiniHudMeshModel::unitVertex(v, cells);
+            map[v].position = QVector2D{ unit[0], unit[1] };
         }
 
-        m_vbo->unmap();
+        vbo->unmap();
     }
 
-    static constexpr uint32_t region_width = 3;
-    static constexpr uint32_t region_height = 3;
-    static constexpr uint32_t vertexDimensions = region_width * region_height * 6;
-    static constexpr float max_x = 20.0f;
-    static constexpr float max_y = 8.0f;
-    static constexpr int32_t total_regions = 21;
+    static constexpr uint32_t vertexDimensions = MiniHudMeshModel::REGION_VERTEX_COUNT;
+    static constexpr uint32_t control_points = MiniHudMeshModel::REGION_CONTROL_POINTS;
+    static constexpr int32_t total_regions = MiniHudMeshModel::REGION_COUNT;
 };
 
 namespace KWin
@@ -149,34 +141,70 @@ DefaultHudEffect::DefaultHudEffect()
     , m_whitePoint{ 1.0f, 1.0f, 1.0f }
     , m_mirrorLevel{ 5.0f }
     , m_screen{ nullptr }
-    , m_shader(ShaderManager::instance()->generateShaderFromFile(ShaderTrait::MapTexture,
-                                                                 QStringLiteral(":/effects/arhud/shaders/warping_default.vert"),
-                                                                 QStringLiteral(":/effects/arhud/shaders/warping_default.frag")))
+    , m_shaders(QStringLiteral(":/effects/arhud/shaders/warping_default_core.vert"),
+                QStringLiteral(":/effects/arhud/shaders/warping_default_core.frag"),
+                { QByteArray("SINGLE_LEVEL") },
+                &DefaultHudEffect::resolveShaderUniforms)
+    , m_bakedShader(loadShaderVariant(QStringLiteral(":/effects/arhud/shaders/warping_default_baked_core.vert"),
+                                      QStringLiteral(":/effects/arhud/shaders/warping_default_core.frag"),
+                                      {}))
 {
-    if (!m_shader->isValid())
+    // The generic variant is valid for every frame.
+    if (!m_shaders.variant(0))
     {
         qCWarning(KWINARHUD_DEBUG) << "Shader is not valid!";
         return;
     }
 
     qCInfo(KWINARHUD_DEBUG) << "Loading DefaultHudEffect";
+    // The screen is only known once a client binds, the programs can be compiled right away.
+    m_shaders.preload({ SingleLevel });
 
-    m_params1_x_location = m_shader->uniformLocation("params1_x");
-    m_params1_y_location = m_shader->uniformLocation("params1_y");
-    m_params2_x_location = m_shader->uniformLocation("params2_x");
-    m_params2_y_location = m_shader->uniformLocation("params2_y");
-    m_params3_x_location = m_shader->uniformLocation("params3_x");
-    m_params3_y_location = m_shader->uniformLocation("params3_y");
-    m_uv_span_location = m_shader->uniformLocation("uv_span");
-    m_mirrorLevel_location = m_shader->uniformLocation("mirrorLevel");
-    m_whitePointCorrection_location = m_shader->uniformLocation("whitePointCorrection");
-    m_source_location = m_shader->uniformLocation("source");
-    m_window_size_location = m_shader->uniformLocation("window_size");
+    if (m_bakedShader && m_bakedShader->isValid())
+    {
+        m_baked_source_location = m_bakedShader->uniformLocation("source");
+        m_baked_whitePointCorrection_location = m_bakedShader->uniformLocation("whitePointCorrection");
+    }
+    else
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Baked mesh shader is not valid, evaluating the mesh on the GPU only";
+        m_bakedShader.reset();
+    }
+
+    // All regions share the same unit mesh, the region itself is picked in the shader by gl_InstanceID.
+    m_regionMesh = std::make_unique<GLVertexBuffer>(GLVertexBuffer::UsageHint::Static);
+    ::ShaderRegion::setupVBO(m_regionMesh.get(), MiniHudMeshModel::REGION_CELLS);
+    m_coarseRegionMesh = std::make_unique<GLVertexBuffer>(GLVertexBuffer::UsageHint::Static);
+    ::ShaderRegion::setupVBO(m_coarseRegionMesh.get(), 1);
+
+    m_governor.setBudget(std::chrono::microseconds(static_cast<int64_t>(Warping::FRAME_BUDGET_MS * 1000.0f)));
+    m_governor.setStatistics(&m_statistics);
+    m_offscreenFormat = offscreenFormatFromName(QString::fromStdString(Warping::MINI_HUD_OFFSCREEN_FORMAT));
 
     m_miniHudManager = std::make_unique<MBitionMiniHudWarpingManager>(this);
 }
 
-DefaultHudEffect::~DefaultHudEffect() = default;
+DefaultHudEffect::ShaderUniforms DefaultHudEffect::resolveShaderUniforms(ShaderProgram* shader)
+{
+    ShaderUniforms uniforms;
+    uniforms.regionParameters_location = shader->uniformLocation("regionParameters");
+    uniforms.regionBase_location = shader->uniformLocation("regionBase");
+    uniforms.levelCount_location = shader->uniformLocation("levelCount");
+    uniforms.levelIndices_location = shader->uniformLocation("levelIndices");
+    uniforms.levelWeights_location = shader->uniformLocation("levelWeights");
+    uniforms.whitePointCorrection_location = shader->uniformLocation("whitePointCorrection");
+    uniforms.source_location = shader->uniformLocation("source");
+    uniforms.window_size_location = shader->uniformLocation("window_size");
+    return uniforms;
+}
+
+DefaultHudEffect::~DefaultHudEffect()
+{
+    if (m_regionParametersTexture != 0)
+    {
+        glDeleteTextures(1, &m_regionParametersTexture);
+    }
+}
 
 bool DefaultHudEffect::isActive() const
 {
@@ -197,80 +225,381 @@ void DefaultHudEffect::paintScreen(const RenderTarget& renderTarget, const Rende
         return;
     }
 
-    if (m_shaderRegions.empty())
+    const auto frameStart = std::chrono::steady_clock::now();
+
+    // One state per frame, the handlers may publish new ones while the frame is painted.
+    const MiniHudState& state = m_state.read();
+    if (!state.calibration)
     {
-        qCWarning(KWINARHUD_DEBUG) << "paintScreen failed - m_shaderRegions is empty!";
+        qCWarning(KWINARHUD_DEBUG) << "paintScreen failed - no calibration!";
+        m_statistics.frameSkipped();
+        m_scissor.invalidate();
+        effects->paintScreen(renderTarget, renderViewport, mask, region, screen);
         return;
     }
+    if (state.calibration != m_calibration)
+    {
+        if (!m_calibration || state.calibration->sourceRect != m_calibration->sourceRect)
+        {
+            // The last offscreen target shows another part of the display.
+            m_sceneDamage.invalidate();
+        }
+        m_calibration = state.calibration;
+        m_regionParametersDirty = true;
+        invalidateBakedMeshes();
+    }
+    const MiniHudCalibration& calibration = *m_calibration;
 
-    checkGlTexture();
-    if (!m_framebuffer)
+    const MirrorState& mirror = state.mirror;
+    if (mirror.mirrorLevel != m_mirrorLevel)
     {
-        qCWarning(KWINARHUD_DEBUG) << "paintScreen failed - framebuffer is nullptr!";
-        effects->paintScreen(renderTarget, renderViewport, mask, region, screen);
-        return;
+        m_mirrorLevelStableFrames = 0;
     }
+    m_mirrorLevel = mirror.mirrorLevel;
+    m_whitePoint = mirror.whitePoint;
 
-    GLFramebuffer::pushFramebuffer(m_framebuffer.get());
-    effects->paintScreen(renderTarget, renderViewport, mask, region, screen);
-    GLFramebuffer::popFramebuffer();
+    m_governor.beginFrame();
+
+    // Without damage on the HUD only the mirror level moved, the last offscreen target is warped again.
+    if (!Warping::PERFORMANCE_OVERLAY && m_overlay.takeDrawn())
+    {
+        // The last offscreen target still shows the overlay that got switched off.
+        m_sceneDamage.invalidate();
+    }
+    const bool damaged = m_sceneDamage.takeDamage(screen->geometry());
+    const bool reproject = Warping::WARP_ONLY_REPROJECTION && !damaged
+                           && m_offscreen.isReusable(m_offscreenFormat, scaledTargetSize(calibration.sourceRect, m_governor.renderScale()));
+    if (!reproject)
+    {
+        checkGlTexture();
+        if (!m_offscreen.framebuffer())
+        {
+            qCWarning(KWINARHUD_DEBUG) << "paintScreen failed - framebuffer is nullptr!";
+            m_statistics.frameSkipped();
+            m_sceneDamage.invalidate();
+            m_governor.endFrame();
+            m_scissor.invalidate();
+            effects->paintScreen(renderTarget, renderViewport, mask, region, screen);
+            return;
+        }
+
+        paintScreenArea(m_offscreen.framebuffer(), calibration.sourceRect, m_governor.renderScale(), renderTarget, renderViewport, mask, region, screen, m_regionCache);
+    }
+    if (Warping::PERFORMANCE_OVERLAY)
+    {
+        // Reprojected frames draw it again into the target they reuse, the opaque panel covers the previous values.
+        m_overlay.draw(m_offscreen.framebuffer(), m_statistics, m_governor);
+    }
+    const auto warpStart = std::chrono::steady_clock::now();
 
     glActiveTexture(GL_TEXTURE0);
-    m_texture->bind();
+    m_offscreen.texture()->setFilter(m_governor.textureFilter());
+    m_offscreen.texture()->bind();
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glClearColor(0, 0, 0, 0);
-    glClear(GL_COLOR_BUFFER_BIT);
+    // The fragment shader drops the alpha channel, so the offscreen format does not need one and blending would only
+    // read back the destination for nothing.
+    glDisable(GL_BLEND);
+    // Clear the background and restrict the draw to where the mesh of this mirror level lands.
+    const std::array<float, 4> bounds = calibration.meshModel.bounds(m_mirrorLevel);
+    m_scissor.begin(QRectF(QPointF(bounds[0], bounds[1]), QPointF(bounds[2], bounds[3])));
 
-    ShaderManager* sm = ShaderManager::instance();
-    sm->pushShader(m_shader.get());
+    if (GLVertexBuffer* baked = bakedMesh())
+    {
+        drawBakedMesh(baked);
+        m_statistics.setWarpPath(s_bakedMeshPath);
+    }
+    else
+    {
+        drawInstanced();
+    }
+    m_scissor.end();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_offscreen.texture()->unbind();
+    m_offscreen.release();
+
+    m_frameCount++;
+    m_mirrorLevelStableFrames++;
+
+    const auto frameEnd = std::chrono::steady_clock::now();
+    m_statistics.frameRendered(frameEnd - frameStart, frameEnd - warpStart);
+    if (reproject)
+    {
+        m_statistics.frameReprojected();
+    }
 
-    for (uint32_t i = 0; i < ::ShaderRegion::total_regions; i++)
+    const bool tierChanged = m_governor.endFrame();
+    if (tierChanged || m_governor.meshMaxErrorPixels(Warping::MESH_MAX_ERROR_PIXELS) != m_pendingState.calibration->meshMaxError)
     {
-        m_shader->setUniform(m_params1_x_location, m_shaderRegions[i].params1_x);
-        m_shader->setUniform(m_params1_y_location, m_shaderRegions[i].params1_y);
-        m_shader->setUniform(m_params2_x_location, m_shaderRegions[i].params2_x);
-        m_shader->setUniform(m_params2_y_location, m_shaderRegions[i].params2_y);
-        m_shader->setUniform(m_params3_x_location, m_shaderRegions[i].params3_x);
-        m_shader->setUniform(m_params3_y_location, m_shaderRegions[i].params3_y);
-        m_shader->setUniform(m_uv_span_location, m_shaderRegions[i].uv_span);
-        m_shader->setUniform(m_mirrorLevel_location, m_mirrorLevel);
-        m_shader->setUniform(m_whitePointCorrection_location, m_whitePoint);
-        m_shader->setUniform(m_source_location, 0);
-        m_shader->setUniform(m_window_size_location, QVector2D{ static_cast<float>(m_hudSize.displayWidth),
-                                                                static_cast<float>(m_hudSize.displayHeight) });
+        scheduleQualityUpdate();
+    }
+
+    effects->addRepaint(screen->geometry());
+}
+
+void DefaultHudEffect::drawBakedMesh(GLVertexBuffer* vbo)
+{
+    m_bakedShader->bind();
 
-        m_shaderRegions[i].m_vbo->bindArrays();
-        m_shaderRegions[i].m_vbo->draw(GL_TRIANGLES, 0, ShaderRegion::vertexDimensions);
-        m_shaderRegions[i].m_vbo->unbindArrays();
+    m_bakedShader->setUniform(m_baked_source_location, 0);
+    m_bakedShader->setUniform(m_baked_whitePointCorrection_location, m_whitePoint);
+
+    vbo->bindArrays();
+    vbo->draw(GL_TRIANGLES, 0, static_cast<int>(m_calibration->meshModel.vertexCount()));
+    vbo->unbindArrays();
+
+    m_bakedShader->unbind();
+}
+
+void DefaultHudEffect::drawInstanced()
+{
+    // The spline basis is evaluated once per frame, every vertex only blends the few contributing levels.
+    const MiniHudCalibration& calibration = *m_calibration;
+    MiniHudMeshModel::BasisWeights basis = MiniHudMeshModel::basisWeights(m_mirrorLevel, calibration.meshModel.levelCount());
+
+    // At a calibrated mirror level a single level contributes, the shader then skips the blending.
+    uint32_t key = 0;
+    const auto single = std::find(basis.weights.begin(), basis.weights.end(), 1.0f);
+    if (single != basis.weights.end()
+        && std::count(basis.weights.begin(), basis.weights.end(), 0.0f) == MiniHudMeshModel::BASIS_SIZE - 1)
+    {
+        std::swap(basis.levels[0], basis.levels[single - basis.weights.begin()]);
+        std::swap(basis.weights[0], *single);
+        key |= SingleLevel;
+    }
+    auto variant = m_shaders.variant(key);
+    if (!variant)
+    {
+        key = 0;
+        variant = m_shaders.variant(key);
+    }
+    if (!variant)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "drawInstanced failed - no valid shader variant!";
+        return;
     }
+    ShaderProgram* shader = variant->shader.get();
+    const ShaderUniforms& uniforms = variant->uniforms;
+    m_statistics.setWarpPath(key);
 
-    sm->popShader();
+    uploadRegionParameters();
 
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_regionParametersTexture);
     glActiveTexture(GL_TEXTURE0);
+
+    shader->bind();
+
+    shader->setUniform(uniforms.source_location, 0);
+    shader->setUniform(uniforms.regionParameters_location, 1);
+    shader->setUniform(uniforms.levelCount_location, static_cast<int>(calibration.meshModel.levelCount()));
+    glUniform1iv(uniforms.levelIndices_location, MiniHudMeshModel::BASIS_SIZE, basis.levels.data());
+    glUniform1fv(uniforms.levelWeights_location, MiniHudMeshModel::BASIS_SIZE, basis.weights.data());
+    shader->setUniform(uniforms.whitePointCorrection_location, m_whitePoint);
+    shader->setUniform(uniforms.window_size_location, QVector2D{ calibration.windowWidth, calibration.windowHeight });
+
+    // The rows of the coarse regions come first in the parameter texture, see setupShaderRegions().
+    const GLsizei coarseRegions = static_cast<GLsizei>(calibration.meshModel.coarseRegionCount());
+    if (coarseRegions > 0)
+    {
+        shader->setUniform(uniforms.regionBase_location, 0);
+        m_coarseRegionMesh->bindArrays();
+        glDrawArraysInstanced(GL_TRIANGLES, 0, MiniHudMeshModel::COARSE_VERTEX_COUNT, coarseRegions);
+        m_coarseRegionMesh->unbindArrays();
+    }
+    if (coarseRegions < ::ShaderRegion::total_regions)
+    {
+        shader->setUniform(uniforms.regionBase_location, static_cast<int>(coarseRegions));
+        m_regionMesh->bindArrays();
+        glDrawArraysInstanced(GL_TRIANGLES, 0, ::ShaderRegion::vertexDimensions, ::ShaderRegion::total_regions - coarseRegions);
+        m_regionMesh->unbindArrays();
+    }
+
+    shader->unbind();
+
+    glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, 0);
-    m_texture->unbind();
+    glActiveTexture(GL_TEXTURE0);
+}
 
-    effects->addRepaint(screen->geometry());
+GLVertexBuffer* DefaultHudEffect::bakedMesh()
+{
+    const MiniHudMeshModel& meshModel = m_calibration->meshModel;
+    if (m_forceInstanced || !m_bakedShader || !meshModel.isValid())
+    {
+        return nullptr;
+    }
+
+    BakedMesh* slot = &m_bakedMeshes[0];
+    for (BakedMesh& mesh : m_bakedMeshes)
+    {
+        if (mesh.valid && mesh.mirrorLevel == m_mirrorLevel)
+        {
+            mesh.lastUsed = m_frameCount;
+            return mesh.vbo.get();
+        }
+        if (!mesh.valid || (slot->valid && mesh.lastUsed < slot->lastUsed))
+        {
+            slot = &mesh;
+        }
+    }
+
+    // While the mirror is moving the level changes every frame. Evaluate those frames in the vertex shader instead
+    // of re-specifying a vertex buffer the GPU may still be reading from, and bake once the level has settled.
+    if (m_mirrorLevelStableFrames == 0)
+    {
+        return nullptr;
+    }
+
+    if (!slot->vbo)
+    {
+        slot->vbo = std::make_unique<GLVertexBuffer>(GLVertexBuffer::UsageHint::Static);
+        const GLVertexAttrib attribs[] = {
+            { VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position) },
+            { VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord) },
+        };
+        slot->vbo->setAttribLayout(attribs, sizeof(GLVertex2D));
+    }
+
+    const auto map = slot->vbo->map<float>(meshModel.vertexCount() * MiniHudMeshModel::FLOATS_PER_VERTEX);
+    if (!map)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "bakedMesh failed - GLVertexBuffer::map() returned nullptr!";
+        slot->valid = false;
+        return nullptr;
+    }
+    meshModel.evaluate(m_mirrorLevel, map->data());
+    slot->vbo->unmap();
+
+    slot->mirrorLevel = m_mirrorLevel;
+    slot->lastUsed = m_frameCount;
+    slot->valid = true;
+    qCDebug(KWINARHUD_DEBUG) << "Baked mini hud mesh for mirror level" << m_mirrorLevel;
+    return slot->vbo.get();
+}
+
+void DefaultHudEffect::invalidateBakedMeshes()
+{
+    for (BakedMesh& mesh : m_bakedMeshes)
+    {
+        mesh.valid = false;
+    }
 }
 
 void DefaultHudEffect::checkGlTexture()
 {
-    const QSize content_size{ static_cast<int>(m_hudSize.displayWidth), static_cast<int>(m_hudSize.displayHeight) };
-    if (!m_texture || m_texture->size() != content_size)
+    // The slots follow a new size or format one by one as they come up again. Ahead of the first calibration, e.g.
+    // in prewarm(), the latest source rect is the best guess.
+    const QRect& sourceRect = m_calibration ? m_calibration->sourceRect : m_sourceRect;
+    const QSize content_size = scaledTargetSize(sourceRect, m_governor.renderScale());
+    m_offscreen.setDepth(Warping::OFFSCREEN_RING_DEPTH);
+    m_offscreen.acquire(m_offscreenFormat, content_size, m_screen ? m_screen->refreshRate() : 60000);
+    m_statistics.setOffscreenBytes(m_offscreen.bytes());
+}
+
+void DefaultHudEffect::scheduleQualityUpdate()
+{
+    if (m_qualityUpdatePending)
+    {
+        return;
+    }
+    m_qualityUpdatePending = true;
+
+    QTimer::singleShot(0, this, [this]() {
+        m_qualityUpdatePending = false;
+        if (!effects->makeOpenGLContextCurrent())
+        {
+            return;
+        }
+        if (!m_levelParameters.empty())
+        {
+            setupShaderRegions(m_levelParameters);
+        }
+        m_offscreen.prepare(m_offscreenFormat, scaledTargetSize(m_sourceRect, m_governor.renderScale()),
+                            m_screen ? m_screen->refreshRate() : 60000);
+        m_statistics.setOffscreenBytes(m_offscreen.bytes());
+    });
+}
+
+void DefaultHudEffect::setOffscreenFormat(OffscreenFormat format)
+{
+    // Every slot of the ring is replaced when it is acquired next.
+    m_offscreenFormat = format;
+}
+
+void DefaultHudEffect::setForceInstanced(bool force)
+{
+    m_forceInstanced = force;
+}
+
+QString DefaultHudEffect::warpPathName(uint32_t path)
+{
+    if (path == s_bakedMeshPath)
+    {
+        return QStringLiteral("baked mesh");
+    }
+    return (path & SingleLevel) ? QStringLiteral("instanced, single level") : QStringLiteral("instanced");
+}
+
+void DefaultHudEffect::uploadRegionParameters()
+{
+    if (!m_regionParametersDirty || !m_calibration)
+    {
+        return;
+    }
+
+    if (m_regionParametersTexture == 0)
+    {
+        glGenTextures(1, &m_regionParametersTexture);
+        if (m_regionParametersTexture == 0)
+        {
+            qCWarning(KWINARHUD_DEBUG) << "uploadRegionParameters failed - could not create texture!";
+            return;
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_regionParametersTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGBA32F,
+                 static_cast<GLsizei>(m_calibration->regionParameterTexels),
+                 ::ShaderRegion::total_regions,
+                 0,
+                 GL_RGBA,
+                 GL_FLOAT,
+                 m_calibration->regionParameters.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_regionParametersDirty = false;
+}
+
+void DefaultHudEffect::prewarm()
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // Every slot of the ring, the first frames would allocate them otherwise.
+    m_offscreen.setDepth(Warping::OFFSCREEN_RING_DEPTH);
+    for (uint32_t slot = 0; slot < m_offscreen.depth(); slot++)
     {
-        qCInfo(KWINARHUD_DEBUG) << "Setting texture and framebuffer with size:" << content_size.width() << content_size.height();
-        m_texture = GLTexture::allocate(GL_RGBA8, content_size);
-        m_texture->setFilter(GL_LINEAR);
-        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_framebuffer = std::make_unique<GLFramebuffer>(m_texture.get());
+        checkGlTexture();
+    }
 
-        m_texture->bind();
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        m_texture->unbind();
+    std::vector<ShaderProgram*> programs = m_shaders.preload({ 0, SingleLevel });
+    if (m_bakedShader)
+    {
+        programs.push_back(m_bakedShader.get());
     }
+    prewarmPrograms(m_offscreen.framebuffer(), programs);
+
+    // Include the work the driver queued, it would otherwise land in the first frame.
+    glFinish();
+
+    m_prewarmDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    qCInfo(KWINARHUD_DEBUG) << "Prewarmed" << programs.size() << "programs and the offscreen target in"
+                            << m_prewarmDuration.count() / 1000.0 << "ms";
 }
 
 MBitionMiniHudWarping* DefaultHudEffect::miniHud(Output* screen)
@@ -283,13 +612,24 @@ MBitionMiniHudWarping* DefaultHudEffect::miniHud(Output* screen)
         qCWarning(KWINARHUD_DEBUG) << "miniHud() failed: wrong screen!";
         return nullptr;
     }
-    m_screen = screen;
+    if (screen != m_screen)
+    {
+        m_screen = screen;
+        updateSourceRect();
+    }
 
     if (!m_miniHud)
     {
         qCInfo(KWINARHUD_DEBUG) << "Creating mini hud for screen " << screen->name();
         m_miniHud.reset(new MBitionMiniHudWarping(this));
-        checkGlTexture();
+        // Not in the handler, the compositor would block on shader compilation before answering the client, and not in
+        // the first frame either, which would stall on it instead.
+        QTimer::singleShot(0, this, [this]() {
+            if (m_miniHud && effects->makeOpenGLContextCurrent())
+            {
+                prewarm();
+            }
+        });
     }
 
     return m_miniHud.get();
@@ -301,17 +641,54 @@ void DefaultHudEffect::setHudSize(unsigned int displayWidth, unsigned int displa
     m_hudSize.displayHeight = displayHeight;
     m_hudSize.appAreaWidth = appAreaWidth;
     m_hudSize.appAreaHeight = appAreaHeight;
+
+    // The app area is centered in the display, in texture coordinates of the whole display.
+    m_appArea = QRectF{ (displayWidth - appAreaWidth) / 2.0 / displayWidth,
+                        (displayHeight - appAreaHeight) / 2.0 / displayHeight,
+                        static_cast<double>(appAreaWidth) / displayWidth,
+                        static_cast<double>(appAreaHeight) / displayHeight };
+    updateSourceRect();
+}
+
+void DefaultHudEffect::updateSourceRect()
+{
+    // The request carries logical pixels, the offscreen targets and paintScreenArea() work in device pixels.
+    const double scale = m_screen ? m_screen->scale() : 1.0;
+    const QSize deviceSize{ static_cast<int>(std::lround(m_hudSize.displayWidth * scale)),
+                            static_cast<int>(std::lround(m_hudSize.displayHeight * scale)) };
+    // Only the app area is sampled by the regions, see setupShaderRegions().
+    m_sourceRect = sampledPixelRect(m_appArea, deviceSize);
+    m_sourceUvRect = QRectF{ static_cast<double>(m_sourceRect.x()) / deviceSize.width(),
+                             static_cast<double>(m_sourceRect.y()) / deviceSize.height(),
+                             static_cast<double>(m_sourceRect.width()) / deviceSize.width(),
+                             static_cast<double>(m_sourceRect.height()) / deviceSize.height() };
+    qCInfo(KWINARHUD_DEBUG) << "Mini hud source rect" << m_sourceRect << "at scale" << scale;
+    if (!m_levelParameters.empty())
+    {
+        // The content area of the regions is relative to the source rect.
+        setupShaderRegions(m_levelParameters);
+    }
 }
 
 void DefaultHudEffect::setMatrices(int fd)
 {
-    std::array<params_t, 3> params;
-    ssize_t data_size = 378 * sizeof(float);
+    const auto start = std::chrono::steady_clock::now();
+
+    // The fd holds one parameter set per calibrated level, spread evenly over the mirror level range.
+    constexpr ssize_t data_size = MiniHudMeshModel::PARAMETER_COUNT * sizeof(float);
+    const off_t file_size = lseek(fd, 0, SEEK_END);
+    if (file_size < data_size || file_size % data_size != 0) {
+        qCWarning(KWINARHUD_DEBUG) << "setMatrices failed - invalid size of the parameter file:" << file_size;
+        close(fd);
+        return;
+    }
+
+    std::vector<params_t> params(static_cast<size_t>(file_size / data_size));
     lseek(fd, 0, SEEK_SET);
     for (params_t& param : params) {
         ssize_t bytes_read = read(fd, param.data(), data_size);
 
-        if (bytes_read == 0) {
+        if (bytes_read != data_size) {
             char buf[256];
             char* msg = strerror_r(errno, buf, sizeof(buf));
             qCWarning(KWINARHUD_DEBUG) << "Error reading data from the file descriptor ..." << msg;
@@ -321,49 +698,84 @@ void DefaultHudEffect::setMatrices(int fd)
     }
 
     close(fd);
-    qCInfo(KWINARHUD_DEBUG) << "setMatrices";
-    setupShaderRegions(params[0], params[1], params[2]);
+    qCInfo(KWINARHUD_DEBUG) << "setMatrices, calibrated levels:" << params.size();
+    m_levelParameters = std::move(params);
+    setupShaderRegions(m_levelParameters);
+
+    m_statistics.record(WarpingStatistics::Timing::MatrixUpload, std::chrono::steady_clock::now() - start);
 }
 
 void DefaultHudEffect::setMirrorLevel(float mirrorLevel)
 {
-    qCInfo(KWINARHUD_DEBUG) << "setMirrorLevel, mirrorLevel=" << mirrorLevel;
-    m_mirrorLevel = mirrorLevel;
+    qCDebug(KWINARHUD_DEBUG) << "setMirrorLevel, mirrorLevel=" << mirrorLevel;
+    m_statistics.poseReceived();
+    m_pendingState.mirror.mirrorLevel = mirrorLevel;
+    m_state.publish(m_pendingState);
 }
 
 void DefaultHudEffect::setWhitePoint(float red, float green, float blue)
 {
     qCInfo(KWINARHUD_DEBUG) << "setWhitePoint, red=" << red << ", green=" << green << ", blue=" << blue;
-    m_whitePoint.setX(red);
-    m_whitePoint.setY(green);
-    m_whitePoint.setZ(blue);
+    m_pendingState.mirror.whitePoint = QVector3D{ red, green, blue };
+    m_state.publish(m_pendingState);
 }
 
-void DefaultHudEffect::setupShaderRegions(const params_t& params1, const params_t& params2, const params_t& params3)
+void DefaultHudEffect::setupShaderRegions(const std::vector<params_t>& params)
 {
-    m_shaderRegions.clear();
-
-    QVector2D margins = { (m_hudSize.displayWidth - m_hudSize.appAreaWidth) / 2.f,
-                          (m_hudSize.displayHeight - m_hudSize.appAreaHeight) / 2.f };
-    QVector4D content_area = { margins.x() / m_hudSize.displayWidth,
-                               margins.y() / m_hudSize.displayHeight,
-                               (m_hudSize.displayWidth - margins.x()) / m_hudSize.displayWidth,
-                               (m_hudSize.displayHeight - margins.y()) / m_hudSize.displayHeight };
+    auto calibration = std::make_shared<MiniHudCalibration>();
+
+    // Texture coordinates of the app area within the offscreen texture, which only covers m_sourceRect. Every edge is
+    // mapped on its own, the rounding of m_sourceRect need not be symmetric.
+    const auto remapX = [this](double x) {
+        return static_cast<float>((x - m_sourceUvRect.left()) / m_sourceUvRect.width());
+    };
+    const auto remapY = [this](double y) {
+        return static_cast<float>((y - m_sourceUvRect.top()) / m_sourceUvRect.height());
+    };
+    const QVector4D content_area = { remapX(m_appArea.left()), remapY(m_appArea.top()),
+                                     remapX(m_appArea.right()), remapY(m_appArea.bottom()) };
 
     qCInfo(KWINARHUD_DEBUG) << "content_area: [" << content_area.x() << "-" << content_area.z() << "] [" <<content_area.y() << "-" << content_area.w() << "]";
 
-    for (int32_t index = 0; index < ::ShaderRegion::total_regions; index++)
+    const std::vector<MiniHudMeshModel::Region> regions =
+        MiniHudMeshModel::layoutRegions({ content_area.x(), content_area.y(), content_area.z(), content_area.w() });
+    std::vector<::ShaderRegion> shaderRegions;
+    shaderRegions.reserve(regions.size());
+    for (const MiniHudMeshModel::Region& region : regions)
     {
-        uint32_t x = uint32_t{ static_cast<uint32_t>(std::max(int32_t{ 0 }, (index % 7) * 3 - 1)) };
-        uint32_t y = uint32_t{ static_cast<uint32_t>(std::max(int32_t{ 0 }, (index / 7) * 3 - 1)) };
-
-        QVector4D uv_span = { content_area.x() + (x / 20.f) * (content_area.z() - content_area.x()),
-                              content_area.y() + (y / 8.f) * (content_area.w() - content_area.y()),
-                              content_area.x() + ((x + 3) / 20.f) * (content_area.z() - content_area.x()),
-                              content_area.y() + ((y + 3) / 8.f) * (content_area.w() - content_area.y()) };
-
-        m_shaderRegions.emplace_back(x, y, uv_span, params1, params2, params3);
+        const QVector4D uv_span = { region.uvSpan[0], region.uvSpan[1], region.uvSpan[2], region.uvSpan[3] };
+        shaderRegions.emplace_back(region.x, region.y, uv_span, params);
     }
+    calibration->sourceRect = m_sourceRect;
+    calibration->windowWidth = static_cast<float>(m_hudSize.displayWidth);
+    calibration->windowHeight = static_cast<float>(m_hudSize.displayHeight);
+    calibration->meshMaxError = m_governor.meshMaxErrorPixels(Warping::MESH_MAX_ERROR_PIXELS);
+    MiniHudMeshModel& meshModel = calibration->meshModel;
+    meshModel.setup(regions, params, calibration->windowWidth, calibration->windowHeight, calibration->meshMaxError);
+
+    qCInfo(KWINARHUD_DEBUG) << "Mini hud mesh:" << meshModel.coarseRegionCount() << "of" << ::ShaderRegion::total_regions
+                            << "regions coarse," << meshModel.vertexCount() << "vertices, estimated error"
+                            << meshModel.estimatedErrorPixels() << "px";
+
+    // Coarse regions are packed first so that both meshes draw a contiguous range of rows.
+    calibration->regionParameterTexels = ::ShaderRegion::texelsPerRegion(params.size());
+    calibration->regionParameters.resize(::ShaderRegion::total_regions * calibration->regionParameterTexels * 4);
+    uint32_t row = 0;
+    for (const bool coarse : { true, false })
+    {
+        for (int32_t index = 0; index < ::ShaderRegion::total_regions; index++)
+        {
+            if (meshModel.isCoarse(index) == coarse)
+            {
+                shaderRegions[index].pack(&calibration->regionParameters[row++ * calibration->regionParameterTexels * 4], params);
+            }
+        }
+    }
+
+    // The next frame picks it up together with the mirror state, frames already painting keep theirs.
+    calibration->generation = ++m_generation;
+    m_pendingState.calibration = std::move(calibration);
+    m_state.publish(m_pendingState);
 }
 
 } // namespace KWin
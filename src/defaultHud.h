@@ -4,20 +4,30 @@
 #pragma once
 
 #include <effect/effect.h>
+#include <epoxy/gl.h>
+#include <chrono>
 #include <vector>
 
-struct ShaderRegion;
+#include "frameBudgetGovernor.h"
+#include "offscreenTarget.h"
+#include "performanceOverlay.h"
+#include "sceneDamageTracker.h"
+#include "shaderVariants.h"
+#include "warpScissor.h"
+#include "warpState.h"
+#include "warpingStatistics.h"
+#include "MiniHudMeshModel.hxx"
+
 class MBitionMiniHudWarping;
 class MBitionMiniHudWarpingManager;
 
-using params_t = std::array<float, 378>;
+using params_t = MiniHudMeshModel::Parameters;
 
 namespace KWin
 {
 
 class GLTexture;
 class GLFramebuffer;
-class GLShader;
 class GLVertexBuffer;
 
 class WarpingEffect;
@@ -42,8 +52,71 @@ public:
     void setMirrorLevel(float mirrorLevel);
     void setWhitePoint(float red, float green, float blue);
 
+    // Time the prewarm of the GPU resources took, zero until a mini hud client bound.
+    std::chrono::microseconds prewarmDuration() const { return m_prewarmDuration; }
+
+    WarpingStatistics& statistics() { return m_statistics; }
+    const FrameBudgetGovernor& governor() const { return m_governor; }
+
+    // Describes a warp path recorded in the statistics.
+    static QString warpPathName(uint32_t path);
+
+    // Requested format of the offscreen target, a change reallocates it in the next frame.
+    OffscreenFormat offscreenFormat() const { return m_offscreenFormat; }
+    void setOffscreenFormat(OffscreenFormat format);
+
+    // Evaluates the mesh in the vertex shader in every frame instead of baking it once the mirror level settled.
+    bool forceInstanced() const { return m_forceInstanced; }
+    void setForceInstanced(bool force);
+
 private:
-    void setupShaderRegions(const params_t& params1, const params_t& params2, const params_t& params3);
+    // Allocates the offscreen target and draws every program once, so that the first warped frame does not pay for it.
+    // Runs from the event loop after the request handler that created the mini hud, ahead of its first frame.
+    void prewarm();
+    // Builds the regions and the mesh of the level parameters for the current HUD size and publishes them.
+    void setupShaderRegions(const std::vector<params_t>& params);
+    // Converts the app area of the HUD size request into the device pixels of m_screen.
+    void updateSourceRect();
+    // Applies a new governor tier or mesh tolerance after the frame instead of inside paintScreen(): lays the regions
+    // out again and reallocates the offscreen targets that are not in use.
+    void scheduleQualityUpdate();
+    void uploadRegionParameters();
+
+    /**
+     * Returns the vertex buffer with the mesh evaluated on the CPU for the current mirror level, or nullptr
+     * if this frame has to evaluate the mesh in the vertex shader.
+     */
+    GLVertexBuffer* bakedMesh();
+    void invalidateBakedMeshes();
+    void drawBakedMesh(GLVertexBuffer* vbo);
+    void drawInstanced();
+
+    struct BakedMesh {
+        float mirrorLevel{ 0.0f };
+        uint64_t lastUsed{ 0 };
+        bool valid{ false };
+        std::unique_ptr<GLVertexBuffer> vbo;
+    };
+    static constexpr size_t s_bakedMeshCacheSize = 4;
+
+    struct ShaderUniforms {
+        int regionParameters_location = -1;
+        int regionBase_location = -1;
+        int levelCount_location = -1;
+        int levelIndices_location = -1;
+        int levelWeights_location = -1;
+        int whitePointCorrection_location = -1;
+        int source_location = -1;
+        int window_size_location = -1;
+    };
+    static ShaderUniforms resolveShaderUniforms(ShaderProgram* shader);
+
+    // Bits of the shader variant key, see warping_default_core.vert.
+    enum ShaderFeature : uint32_t {
+        SingleLevel = 1 << 0,
+    };
+    // Warp path recorded in the statistics, the shader variant key of drawInstanced() otherwise.
+    static constexpr uint32_t s_bakedMeshPath = 1u << 31;
 
     struct {
         unsigned int displayWidth{ 0 };
@@ -51,29 +124,53 @@ private:
         unsigned int appAreaWidth{ 0 };
         unsigned int appAreaHeight{ 0 };
     } m_hudSize;
+    // App area in texture coordinates of the whole display.
+    QRectF m_appArea;
+    // Part of the display rendered into the offscreen targets in device pixels, and the same in texture coordinates.
+    // The frames use the source rect of their calibration.
+    QRect m_sourceRect;
+    QRectF m_sourceUvRect;
+    ClippedRegionCache m_regionCache;
     uint32_t m_vertexDimensions;
+    // Published by the request handlers, read once per frame into m_calibration, m_whitePoint and m_mirrorLevel.
+    MiniHudState m_pendingState;
+    LatestValue<MiniHudState> m_state;
+    uint32_t m_generation{ 0 };
+    std::shared_ptr<const MiniHudCalibration> m_calibration;
     QVector3D m_whitePoint;
     float m_mirrorLevel;
 
     Output* m_screen;
-    std::unique_ptr<GLShader> m_shader;
-    std::unique_ptr<GLTexture> m_texture;
-    std::unique_ptr<GLFramebuffer> m_framebuffer;
+    ShaderVariantCache<ShaderUniforms> m_shaders;
+    std::unique_ptr<ShaderProgram> m_bakedShader;
+    OffscreenRing m_offscreen;
+    SceneDamageTracker m_sceneDamage;
     std::unique_ptr<MBitionMiniHudWarping> m_miniHud;
     std::unique_ptr<MBitionMiniHudWarpingManager> m_miniHudManager;
-    std::vector<ShaderRegion> m_shaderRegions;
-
-    int m_params1_x_location = -1;
-    int m_params1_y_location = -1;
-    int m_params2_x_location = -1;
-    int m_params2_y_location = -1;
-    int m_params3_x_location = -1;
-    int m_params3_y_location = -1;
-    int m_mirrorLevel_location = -1;
-    int m_whitePointCorrection_location = -1;
-    int m_source_location = -1;
-    int m_uv_span_location = -1;
-    int m_window_size_location = -1;
+    std::unique_ptr<GLVertexBuffer> m_regionMesh;
+    std::unique_ptr<GLVertexBuffer> m_coarseRegionMesh;
+
+    // The region parameters of m_calibration are uploaded lazily from paintScreen.
+    bool m_regionParametersDirty = false;
+    GLuint m_regionParametersTexture = 0;
+
+    // Kept to rebuild the regions when the governor or the configuration changes the mesh tolerance.
+    std::vector<params_t> m_levelParameters;
+    bool m_qualityUpdatePending{ false };
+    FrameBudgetGovernor m_governor{ QStringLiteral("Mini HUD") };
+    WarpingStatistics m_statistics;
+    PerformanceOverlay m_overlay;
+    WarpScissor m_scissor;
+    OffscreenFormat m_offscreenFormat{ OffscreenFormat::RGBA8 };
+    bool m_forceInstanced{ false };
+
+    std::array<BakedMesh, s_bakedMeshCacheSize> m_bakedMeshes;
+    uint64_t m_frameCount{ 0 };
+    uint32_t m_mirrorLevelStableFrames{ 0 };
+    std::chrono::microseconds m_prewarmDuration{ 0 };
+
+    int m_baked_source_location = -1;
+    int m_baked_whitePointCorrection_location = -1;
 };
 
 } // namespace KWin
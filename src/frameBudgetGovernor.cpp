@@ -0,0 +1,245 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "frameBudgetGovernor.h"
+#include "warpingStatistics.h"
+
+#include <algorithm>
+
+#include "kwinarhud_debug.h"
+
+namespace KWin
+{
+
+FrameBudgetGovernor::FrameBudgetGovernor(const QString& name)
+    : m_name(name)
+{
+    m_gpuTimerSupported = epoxy_is_desktop_gl()
+        ? (epoxy_gl_version() >= 33 || epoxy_has_gl_extension("GL_ARB_timer_query"))
+        : epoxy_has_gl_extension("GL_EXT_disjoint_timer_query");
+
+    if (m_gpuTimerSupported)
+    {
+        for (std::array<GLuint, 2>& queries : m_queries)
+        {
+            glGenQueries(2, queries.data());
+        }
+    }
+    else
+    {
+        qCInfo(KWINARHUD_DEBUG) << m_name << "governor: no GPU timer queries, watching the CPU time only";
+    }
+}
+
+FrameBudgetGovernor::~FrameBudgetGovernor()
+{
+    if (m_gpuTimerSupported)
+    {
+        for (std::array<GLuint, 2>& queries : m_queries)
+        {
+            glDeleteQueries(2, queries.data());
+        }
+    }
+}
+
+void FrameBudgetGovernor::setBudget(std::chrono::microseconds budget)
+{
+    m_budget = budget;
+    if (m_budget.count() <= 0)
+    {
+        setTier(Tier::Full);
+    }
+}
+
+void FrameBudgetGovernor::setStatistics(WarpingStatistics* statistics)
+{
+    m_statistics = statistics;
+}
+
+bool FrameBudgetGovernor::isMeasuring() const
+{
+    return m_budget.count() > 0 || m_statistics;
+}
+
+void FrameBudgetGovernor::beginFrame()
+{
+    if (!isMeasuring())
+    {
+        return;
+    }
+
+    m_frameStart = std::chrono::steady_clock::now();
+    if (m_gpuTimerSupported && !m_queryPending[m_queryFrame])
+    {
+        glQueryCounter(m_queries[m_queryFrame][0], GL_TIMESTAMP);
+    }
+}
+
+bool FrameBudgetGovernor::endFrame()
+{
+    if (!isMeasuring())
+    {
+        return false;
+    }
+
+    const double cpuTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_frameStart).count();
+    m_cpuTime += s_smoothing * (cpuTime - m_cpuTime);
+
+    if (m_gpuTimerSupported)
+    {
+        if (!m_queryPending[m_queryFrame])
+        {
+            glQueryCounter(m_queries[m_queryFrame][1], GL_TIMESTAMP);
+            m_queryPending[m_queryFrame] = true;
+        }
+        m_queryFrame = (m_queryFrame + 1) % s_queryFrames;
+        collectGpuTimes();
+    }
+
+    if (m_budget.count() <= 0)
+    {
+        return false;
+    }
+
+    const double frameTime = std::max(m_cpuTime, m_gpuTime);
+    const double budget = static_cast<double>(m_budget.count());
+    m_framesOverBudget = frameTime > budget ? m_framesOverBudget + 1 : 0;
+    m_framesUnderBudget = frameTime < budget * s_stepUpHeadroom ? m_framesUnderBudget + 1 : 0;
+
+    if (m_pendingTier != m_tier)
+    {
+        // The frames measured meanwhile still ran at the applied tier, so they have to keep confirming the step.
+        const bool confirmed = m_pendingTier > m_tier ? frameTime > budget : frameTime < budget * s_stepUpHeadroom;
+        if (!confirmed)
+        {
+            qCDebug(KWINARHUD_DEBUG) << m_name << "governor: dropping the step to tier" << tierName(m_pendingTier);
+            m_pendingTier = m_tier;
+            return false;
+        }
+        if (++m_framesPending < s_framesToApply)
+        {
+            return false;
+        }
+    }
+    else if (m_framesOverBudget >= s_framesToStepDown && m_tier != Tier::NearestFilter)
+    {
+        m_pendingTier = static_cast<Tier>(static_cast<int>(m_tier) + 1);
+        m_framesPending = 0;
+        return false;
+    }
+    else if (m_framesUnderBudget >= s_framesToStepUp && m_tier != Tier::Full)
+    {
+        m_pendingTier = static_cast<Tier>(static_cast<int>(m_tier) - 1);
+        m_framesPending = 0;
+        return false;
+    }
+
+    const Tier previous = m_tier;
+    if (m_pendingTier != m_tier)
+    {
+        setTier(m_pendingTier);
+        qCInfo(KWINARHUD_DEBUG) << m_name << "governor: frame time" << frameTime / 1000.0 << "ms (cpu" << m_cpuTime / 1000.0
+                                << "ms, gpu" << m_gpuTime / 1000.0 << "ms), budget" << budget / 1000.0 << "ms, tier"
+                                << tierName(previous) << "->" << tierName(m_tier);
+        return true;
+    }
+    return false;
+}
+
+void FrameBudgetGovernor::collectGpuTimes()
+{
+    if (!epoxy_is_desktop_gl())
+    {
+        // A disjoint operation like a frequency change invalidates all pending timestamps.
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (disjoint)
+        {
+            m_queryPending.fill(false);
+            return;
+        }
+    }
+
+    for (size_t frame = 0; frame < s_queryFrames; frame++)
+    {
+        if (!m_queryPending[frame])
+        {
+            continue;
+        }
+
+        GLuint available = 0;
+        glGetQueryObjectuiv(m_queries[frame][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            continue;
+        }
+
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(m_queries[frame][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(m_queries[frame][1], GL_QUERY_RESULT, &end);
+        m_queryPending[frame] = false;
+
+        if (end > begin)
+        {
+            const double gpuTime = static_cast<double>(end - begin) / 1000.0;
+            m_gpuTime += s_smoothing * (gpuTime - m_gpuTime);
+            if (m_statistics)
+            {
+                m_statistics->record(WarpingStatistics::Timing::FrameGpu, gpuTime);
+            }
+        }
+    }
+}
+
+void FrameBudgetGovernor::setTier(Tier tier)
+{
+    m_tier = tier;
+    m_pendingTier = tier;
+    m_framesPending = 0;
+    m_framesOverBudget = 0;
+    m_framesUnderBudget = 0;
+}
+
+FrameBudgetGovernor::Tier FrameBudgetGovernor::tier() const
+{
+    return m_tier;
+}
+
+QString FrameBudgetGovernor::tierName(Tier tier)
+{
+    switch (tier)
+    {
+    case Tier::Full:
+        return QStringLiteral("full");
+    case Tier::CoarseMesh:
+        return QStringLiteral("coarse mesh");
+    case Tier::ReducedScale:
+        return QStringLiteral("reduced scale");
+    case Tier::NearestFilter:
+        return QStringLiteral("nearest filter");
+    }
+    return QString();
+}
+
+float FrameBudgetGovernor::meshMaxErrorPixels(float configured) const
+{
+    return m_tier >= Tier::CoarseMesh ? std::max(4.0f * configured, 2.0f) : configured;
+}
+
+bool FrameBudgetGovernor::allowBicubicInterpolation() const
+{
+    return m_tier < Tier::CoarseMesh;
+}
+
+double FrameBudgetGovernor::renderScale() const
+{
+    return m_tier >= Tier::ReducedScale ? 0.75 : 1.0;
+}
+
+GLenum FrameBudgetGovernor::textureFilter() const
+{
+    return m_tier >= Tier::NearestFilter ? GL_NEAREST : GL_LINEAR;
+}
+
+} // namespace KWin
@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QString>
+
+#include <epoxy/gl.h>
+
+#include <array>
+#include <chrono>
+
+namespace KWin
+{
+
+class WarpingStatistics;
+
+/**
+ * Watches the CPU and GPU time of the paint pass of one HUD output and trades warp quality for frame time.
+ *
+ * While the smoothed frame time exceeds the budget the governor steps down the quality ladder, once there is enough
+ * headroom again it steps back up. Both directions need a number of consecutive frames, the step up a much larger one
+ * and a clear margin below the budget, so that the tier does not oscillate at the edge of the budget.
+ *
+ * A step is only applied once the frame time kept confirming it for a few more frames, a short spike is dropped before
+ * the effects rebuild their mesh or reallocate their offscreen targets for it.
+ */
+class FrameBudgetGovernor
+{
+public:
+    enum class Tier
+    {
+        Full,
+        CoarseMesh, // larger mesh error tolerance, bilinear interpolation
+        ReducedScale, // offscreen target rendered at a lower scale
+        NearestFilter, // nearest instead of linear filtering of the offscreen target
+    };
+
+    explicit FrameBudgetGovernor(const QString& name);
+    ~FrameBudgetGovernor();
+
+    /**
+     * Sets the frame time budget, 0 disables the governor and keeps the full quality.
+     */
+    void setBudget(std::chrono::microseconds budget);
+    std::chrono::microseconds budget() const { return m_budget; }
+
+    /**
+     * Records the GPU time of every frame into the statistics. The frames are measured even without a budget then.
+     */
+    void setStatistics(WarpingStatistics* statistics);
+
+    /**
+     * Brackets the paint pass. endFrame() returns true if the applied tier changed.
+     */
+    void beginFrame();
+    bool endFrame();
+
+    /**
+     * The applied tier, which the quality settings below follow.
+     */
+    Tier tier() const;
+    static QString tierName(Tier tier);
+
+    /**
+     * Smoothed CPU and GPU time of the paint pass in µs, zero while nothing is measured.
+     */
+    double cpuTime() const { return m_cpuTime; }
+    double gpuTime() const { return m_gpuTime; }
+
+    /**
+     * Returns the mesh error tolerance in pixels for the current tier.
+     */
+    float meshMaxErrorPixels(float configured) const;
+    bool allowBicubicInterpolation() const;
+    double renderScale() const;
+    GLenum textureFilter() const;
+
+private:
+    bool isMeasuring() const;
+    void collectGpuTimes();
+    void setTier(Tier tier);
+
+    static constexpr size_t s_queryFrames = 4;
+    static constexpr uint32_t s_framesToStepDown = 10;
+    static constexpr uint32_t s_framesToStepUp = 120;
+    static constexpr uint32_t s_framesToApply = 15;
+    static constexpr double s_stepUpHeadroom = 0.75;
+    static constexpr double s_smoothing = 0.1;
+
+    QString m_name;
+    std::chrono::microseconds m_budget{ 0 };
+    Tier m_tier = Tier::Full;
+    // The step to m_tier waits for s_framesToApply frames that confirm it.
+    Tier m_pendingTier = Tier::Full;
+    uint32_t m_framesPending = 0;
+    WarpingStatistics* m_statistics = nullptr;
+
+    std::chrono::steady_clock::time_point m_frameStart;
+    double m_cpuTime = 0.0; // µs, exponentially smoothed
+    double m_gpuTime = 0.0; // µs, exponentially smoothed
+    uint32_t m_framesOverBudget = 0;
+    uint32_t m_framesUnderBudget = 0;
+
+    // GPU timestamps at the begin and end of the last frames, read back without stalling a few frames later.
+    bool m_gpuTimerSupported = false;
+    std::array<std::array<GLuint, 2>, s_queryFrames> m_queries{};
+    std::array<bool, s_queryFrames> m_queryPending{};
+    size_t m_queryFrame = 0;
+};
+
+} // namespace KWin
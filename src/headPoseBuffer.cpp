@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "headPoseBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "kwinarhud_debug.h"
+
+namespace KWin
+{
+
+static bool bufferStorageSupported()
+{
+    return epoxy_is_desktop_gl() ? (epoxy_gl_version() >= 44 || epoxy_has_gl_extension("GL_ARB_buffer_storage"))
+                                 : epoxy_has_gl_extension("GL_EXT_buffer_storage");
+}
+
+HeadPoseBuffer::HeadPoseBuffer()
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max<GLint>(alignment, 1);
+    static_assert(sizeof(Pose) <= BLOCK_SIZE);
+    m_slotSize = (BLOCK_SIZE + alignment - 1) / alignment * alignment;
+    const GLsizeiptr size = m_slotSize * SLOT_COUNT;
+
+    glGenBuffers(1, &m_buffer);
+    if (m_buffer == 0)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Failed to create the head pose buffer";
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+
+    if (bufferStorageSupported())
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        if (epoxy_is_desktop_gl())
+        {
+            glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+        }
+        else
+        {
+            glBufferStorageEXT(GL_UNIFORM_BUFFER, size, nullptr, flags);
+        }
+        m_mapping = static_cast<char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+    }
+
+    if (m_mapping)
+    {
+        std::memset(m_mapping, 0, static_cast<size_t>(size));
+    }
+    else
+    {
+        // Buffer storage is immutable, a failed mapping needs a new buffer for glBufferData.
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glDeleteBuffers(1, &m_buffer);
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    qCInfo(KWINARHUD_DEBUG) << "Head pose buffer:" << (m_mapping ? "persistently mapped" : "glBufferSubData") << "with"
+                            << SLOT_COUNT << "slots of" << m_slotSize << "bytes";
+}
+
+HeadPoseBuffer::~HeadPoseBuffer()
+{
+    for (GLsync fence : m_fences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    if (m_mapping)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void HeadPoseBuffer::nextFrame()
+{
+    m_slot = (m_slot + 1) % SLOT_COUNT;
+
+    GLsync& fence = m_fences[m_slot];
+    if (fence)
+    {
+        // The pose is written by the CPU, so unlike the offscreen ring the wait cannot be left to the GPU.
+        if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            qCDebug(KWINARHUD_DEBUG) << "Head pose slot" << m_slot << "still in use, waiting for the GPU";
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void HeadPoseBuffer::write(int32_t matrixIndex, float matrixFactor)
+{
+    const Pose pose{matrixIndex, matrixFactor};
+    const GLintptr offset = m_slotSize * m_slot;
+    if (m_mapping)
+    {
+        // The slot is no longer read by the GPU, nextFrame() waited for its fence.
+        std::memcpy(m_mapping + offset, &pose, sizeof(pose));
+    }
+    else
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(pose), &pose);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+}
+
+void HeadPoseBuffer::bind()
+{
+    // The range has to cover GL_UNIFORM_BLOCK_DATA_SIZE of the block, not only the members.
+    glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, m_buffer, m_slotSize * m_slot, BLOCK_SIZE);
+}
+
+void HeadPoseBuffer::release()
+{
+    // glBufferSubData is ordered by the driver, only the writes to the mapping need the fence.
+    if (!m_mapping)
+    {
+        return;
+    }
+    GLsync& fence = m_fences[m_slot];
+    if (fence)
+    {
+        glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+} // namespace KWin
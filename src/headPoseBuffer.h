@@ -0,0 +1,75 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <epoxy/gl.h>
+
+#include <array>
+#include <cstdint>
+
+namespace KWin
+{
+
+/**
+ * Uniform buffer with the HeadPose block of warping_arhud_classic_core.vert.
+ *
+ * Each frame uses its own slot of a small ring, the pose is written right before the draw and never after it was
+ * submitted. Where buffer storage is available the ring is mapped persistently and coherently, which saves the driver
+ * the copy of glBufferSubData. Otherwise the pose is uploaded with glBufferSubData.
+ *
+ * A persistently mapped slot is fenced after its draw, the CPU waits for that fence before it writes the slot for a
+ * later frame. The GPU normally finished with it two frames ago.
+ */
+class HeadPoseBuffer
+{
+public:
+    static constexpr GLuint BINDING = 0;
+
+    HeadPoseBuffer();
+    ~HeadPoseBuffer();
+
+    HeadPoseBuffer(const HeadPoseBuffer&) = delete;
+    HeadPoseBuffer& operator=(const HeadPoseBuffer&) = delete;
+
+    bool isValid() const { return m_buffer != 0; }
+    bool isPersistent() const { return m_mapping != nullptr; }
+
+    /**
+     * Moves on to the slot of the next frame, the slots of the frames still in flight are left alone.
+     */
+    void nextFrame();
+
+    /**
+     * Writes the pose of the current frame, before its draw is submitted.
+     */
+    void write(int32_t matrixIndex, float matrixFactor);
+
+    /**
+     * Binds the slot of the current frame to BINDING.
+     */
+    void bind();
+
+    /**
+     * Fences the slot of the current frame, to be called once the draw reading it has been submitted.
+     */
+    void release();
+
+private:
+    struct Pose
+    {
+        int32_t matrixInterpolationIndex;
+        float matrixInterpolationFactor;
+    };
+    static constexpr uint32_t SLOT_COUNT = 3;
+    // std140 rounds the size of the block up to the base alignment of a vec4, drivers report 16 bytes for it.
+    static constexpr GLintptr BLOCK_SIZE = 16;
+
+    GLuint m_buffer = 0;
+    GLintptr m_slotSize = 0;
+    uint32_t m_slot = 0;
+    char* m_mapping = nullptr;
+    std::array<GLsync, SLOT_COUNT> m_fences{};
+};
+
+} // namespace KWin
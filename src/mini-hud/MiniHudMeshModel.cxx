@@ -0,0 +1,376 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "MiniHudMeshModel.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Returns the position of a vertex of the shared region mesh. The cells are emitted column by column as two
+ * triangles each: (top left, bottom left, top right) and (top right, bottom left, bottom right).
+ *
+ * @param[in] vertex The vertex index in [0, cells * cells * 6).
+ * @param[in] cells The number of cells per side of the mesh.
+ *
+ * @return The vertex position in [0, 1] x [0, 1].
+ */
+std::array<float, 2> MiniHudMeshModel::unitVertex(uint32_t vertex, uint32_t cells)
+{
+  constexpr std::array<std::array<uint32_t, 2>, 6> corners = {{{0, 0}, {0, 1}, {1, 0}, {1, 0}, {0, 1}, {1, 1}}};
+
+  const uint32_t cell   = vertex / 6;
+  const uint32_t column = cell / cells + corners[vertex % 6][0];
+  const uint32_t row    = cell % cells + corners[vertex % 6][1];
+
+  return {{static_cast<float>(column) / static_cast<float>(cells), static_cast<float>(row) / static_cast<float>(cells)}};
+}
+
+/**
+ * @brief Lays out the regions row by row. The regions start every 3 cells, shifted back by one cell so that the last
+ * region of a row or column ends at the border of the 20 x 8 cell grid. The first one is clamped to the grid and
+ * overlaps its neighbour by a cell.
+ *
+ * @param[in] contentArea The app area in texture coordinates: left, top, right, bottom.
+ *
+ * @return The regions with their first control point and their span in texture coordinates.
+ */
+std::vector<MiniHudMeshModel::Region> MiniHudMeshModel::layoutRegions(const std::array<float, 4>& contentArea)
+{
+  constexpr float gridCellsX = static_cast<float>(PARAMETER_GRID_X - 1);
+  constexpr float gridCellsY = static_cast<float>(PARAMETER_GRID_Y - 1);
+  const float     width      = contentArea[2] - contentArea[0];
+  const float     height     = contentArea[3] - contentArea[1];
+
+  std::vector<Region> regions;
+  regions.reserve(REGION_COUNT);
+  for (uint32_t index = 0; index < REGION_COUNT; index++)
+  {
+    const uint32_t x = std::max(int32_t{0}, static_cast<int32_t>((index % REGION_COLUMNS) * REGION_CELLS) - 1);
+    const uint32_t y = std::max(int32_t{0}, static_cast<int32_t>((index / REGION_COLUMNS) * REGION_CELLS) - 1);
+
+    regions.push_back({x,
+                       y,
+                       {{contentArea[0] + (static_cast<float>(x) / gridCellsX) * width,
+                         contentArea[1] + (static_cast<float>(y) / gridCellsY) * height,
+                         contentArea[0] + (static_cast<float>(x + REGION_CELLS) / gridCellsX) * width,
+                         contentArea[1] + (static_cast<float>(y + REGION_CELLS) / gridCellsY) * height}}});
+  }
+  return regions;
+}
+
+/**
+ * @brief Returns the mirror level of a parameter set. The levels are spaced evenly over [MIRROR_LEVEL_MIN,
+ * MIRROR_LEVEL_MAX], so the three parameter sets of the original protocol map to the levels 0, 5 and 10.
+ *
+ * @param[in] index The index of the parameter set.
+ * @param[in] levelCount The number of parameter sets.
+ *
+ * @return The calibrated mirror level.
+ */
+float MiniHudMeshModel::calibrationLevel(uint32_t index, uint32_t levelCount)
+{
+  if (levelCount < 2)
+  {
+    return MIRROR_LEVEL_MIN;
+  }
+  return MIRROR_LEVEL_MIN +
+         (MIRROR_LEVEL_MAX - MIRROR_LEVEL_MIN) * static_cast<float>(index) / static_cast<float>(levelCount - 1);
+}
+
+/**
+ * @brief Uniform Catmull-Rom spline through the calibrated levels.
+ *
+ * The missing neighbours of the first and last segment are extrapolated quadratically from the three outermost
+ * levels and folded into their weights, and the end segments are continued beyond the calibrated range. With three
+ * levels the spline therefore is exactly the quadratic Lagrange polynomial through them. Two levels are interpolated
+ * linearly and a single level is used as is.
+ *
+ * @param[in] mirrorLevel The mirror level to evaluate.
+ * @param[in] levelCount The number of calibrated levels.
+ *
+ * @return The indices and weights of the contributing levels. The weights always sum up to 1.
+ */
+MiniHudMeshModel::BasisWeights MiniHudMeshModel::basisWeights(float mirrorLevel, uint32_t levelCount)
+{
+  BasisWeights basis{};
+
+  if (levelCount < 2)
+  {
+    basis.weights[0] = 1.0f;
+    return basis;
+  }
+
+  const int32_t last     = static_cast<int32_t>(levelCount) - 1;
+  const float   u        = (mirrorLevel - MIRROR_LEVEL_MIN) / (MIRROR_LEVEL_MAX - MIRROR_LEVEL_MIN) * static_cast<float>(last);
+  const int32_t segment  = std::clamp(static_cast<int32_t>(std::floor(u)), int32_t{0}, last - 1);
+  const float   t        = u - static_cast<float>(segment);
+
+  if (levelCount == 2)
+  {
+    basis.levels  = {{0, 1, 0, 0}};
+    basis.weights = {{1.0f - t, t, 0.0f, 0.0f}};
+    return basis;
+  }
+
+  const float t2 = t * t;
+  const float t3 = t2 * t;
+
+  // Catmull-Rom weights of the control points segment - 1 .. segment + 2.
+  const std::array<float, 4> cr = {{0.5f * (-t + 2.0f * t2 - t3),
+                                    0.5f * (2.0f - 5.0f * t2 + 3.0f * t3),
+                                    0.5f * (t + 4.0f * t2 - 3.0f * t3),
+                                    0.5f * (-t2 + t3)}};
+
+  // Four consecutive levels covering the segment and the real neighbours.
+  const int32_t first = std::clamp(segment - 1, int32_t{0}, std::max(last - 3, int32_t{0}));
+  const int32_t count = std::min(int32_t{4}, last + 1);
+  for (int32_t i = 0; i < count; i++)
+  {
+    basis.levels[i] = first + i;
+  }
+
+  auto addWeight = [&basis, first](int32_t level, float weight)
+  {
+    basis.weights[level - first] += weight;
+  };
+
+  for (int32_t i = 0; i < 4; i++)
+  {
+    const int32_t level = segment - 1 + i;
+    if (level < 0)
+    {
+      // P(-1) = 3 P(0) - 3 P(1) + P(2)
+      addWeight(0, 3.0f * cr[i]);
+      addWeight(1, -3.0f * cr[i]);
+      addWeight(2, cr[i]);
+    }
+    else if (level > last)
+    {
+      // P(n) = 3 P(n - 1) - 3 P(n - 2) + P(n - 3)
+      addWeight(last, 3.0f * cr[i]);
+      addWeight(last - 1, -3.0f * cr[i]);
+      addWeight(last - 2, cr[i]);
+    }
+    else
+    {
+      addWeight(level, cr[i]);
+    }
+  }
+
+  return basis;
+}
+
+namespace
+{
+  /**
+   * @brief Returns the largest distance of the control points of a region from the two triangles spanned by its
+   * corners, split along the same diagonal as the cells of the region mesh.
+   */
+  float coarseError(const MiniHudMeshModel::Region& region, const MiniHudMeshModel::Parameters& level)
+  {
+    constexpr uint32_t cells = MiniHudMeshModel::REGION_CELLS;
+
+    auto point = [&region, &level](uint32_t column, uint32_t row) -> std::array<float, 2>
+    {
+      const uint32_t p = 2 * (region.x + column) + 2 * MiniHudMeshModel::PARAMETER_GRID_X * (region.y + row);
+      return {{level[p], level[p + 1]}};
+    };
+
+    const std::array<float, 2> topLeft     = point(0, 0);
+    const std::array<float, 2> topRight    = point(cells, 0);
+    const std::array<float, 2> bottomLeft  = point(0, cells);
+    const std::array<float, 2> bottomRight = point(cells, cells);
+
+    float error = 0.0f;
+    for (uint32_t column = 0; column <= cells; column++)
+    {
+      for (uint32_t row = 0; row <= cells; row++)
+      {
+        const float u = static_cast<float>(column) / cells;
+        const float v = static_cast<float>(row) / cells;
+
+        std::array<float, 2> approximation;
+        for (uint32_t c = 0; c < 2; c++)
+        {
+          approximation[c] = u + v <= 1.0f
+                               ? topLeft[c] + u * (topRight[c] - topLeft[c]) + v * (bottomLeft[c] - topLeft[c])
+                               : bottomRight[c] + (1.0f - u) * (bottomLeft[c] - bottomRight[c]) +
+                                     (1.0f - v) * (topRight[c] - bottomRight[c]);
+        }
+
+        const std::array<float, 2> actual = point(column, row);
+        error = std::max(error, std::hypot(actual[0] - approximation[0], actual[1] - approximation[1]));
+      }
+    }
+    return error;
+  }
+} // namespace
+
+/**
+ * @brief Resolves the control points of every vertex of all regions.
+ *
+ * @param[in] regions The regions of the mini HUD with their control point offset and texture coordinate span.
+ * @param[in] levels The parameter sets, ordered by calibrated level.
+ * @param[in] windowWidth The width in pixels the parameters are given in.
+ * @param[in] windowHeight The height in pixels the parameters are given in.
+ * @param[in] maxErrorPixels Regions within this error on every level are drawn with a single cell, 0 keeps the full
+ * mesh everywhere.
+ */
+void MiniHudMeshModel::setup(const std::vector<Region>&     regions,
+                             const std::vector<Parameters>& levels,
+                             float                          windowWidth,
+                             float                          windowHeight,
+                             float                          maxErrorPixels)
+{
+  mCoarse.assign(regions.size(), false);
+  mEstimatedErrorPixels = 0.0f;
+  mVertexCount          = 0;
+
+  for (size_t index = 0; index < regions.size() && !levels.empty(); index++)
+  {
+    float error = 0.0f;
+    for (const Parameters& level : levels)
+    {
+      error = std::max(error, coarseError(regions[index], level));
+    }
+
+    mCoarse[index] = maxErrorPixels > 0.0f && error <= maxErrorPixels;
+    if (mCoarse[index])
+    {
+      mEstimatedErrorPixels = std::max(mEstimatedErrorPixels, error);
+    }
+    mVertexCount += mCoarse[index] ? COARSE_VERTEX_COUNT : REGION_VERTEX_COUNT;
+  }
+
+  mTexCoords.assign(mVertexCount * FLOATS_PER_VERTEX, 0.0f);
+  mPositions.resize(levels.size());
+  for (std::vector<float>& positions : mPositions)
+  {
+    positions.assign(mVertexCount * FLOATS_PER_VERTEX, 0.0f);
+  }
+
+  mBounds.assign(levels.size(), {{1.0f, 1.0f, -1.0f, -1.0f}});
+  for (size_t level = 0; level < levels.size(); level++)
+  {
+    std::array<float, 4>& bounds = mBounds[level];
+    for (const Region& region : regions)
+    {
+      for (uint32_t row = region.y; row < region.y + REGION_CONTROL_POINTS; row++)
+      {
+        for (uint32_t column = region.x; column < region.x + REGION_CONTROL_POINTS; column++)
+        {
+          const uint32_t p = 2 * column + 2 * PARAMETER_GRID_X * row;
+          const float    x = 2.0f * levels[level][p] / windowWidth - 1.0f;
+          const float    y = 2.0f * levels[level][p + 1] / windowHeight - 1.0f;
+          bounds          = {{std::min(bounds[0], x), std::min(bounds[1], y), std::max(bounds[2], x),
+                              std::max(bounds[3], y)}};
+        }
+      }
+    }
+  }
+
+  uint32_t vertex = 0;
+  for (size_t index = 0; index < regions.size() && mVertexCount > 0; index++)
+  {
+    const Region&  region      = regions[index];
+    const uint32_t cells       = mCoarse[index] ? 1 : REGION_CELLS;
+    const uint32_t vertexCount = cells * cells * 6;
+
+    for (uint32_t v = 0; v < vertexCount; v++, vertex++)
+    {
+      const std::array<float, 2> unit = unitVertex(v, cells);
+
+      float* texCoord = &mTexCoords[vertex * FLOATS_PER_VERTEX];
+      texCoord[2]     = region.uvSpan[0] + unit[0] * (region.uvSpan[2] - region.uvSpan[0]);
+      texCoord[3]     = region.uvSpan[1] + unit[1] * (region.uvSpan[3] - region.uvSpan[1]);
+
+      const uint32_t column = region.x + static_cast<uint32_t>(unit[0] * REGION_CELLS + 0.5f);
+      const uint32_t row    = region.y + static_cast<uint32_t>(unit[1] * REGION_CELLS + 0.5f);
+      const uint32_t p      = 2 * column + 2 * PARAMETER_GRID_X * row;
+
+      for (size_t level = 0; level < levels.size(); level++)
+      {
+        // The basis weights sum up to 1, so the viewport transformation can be applied to the control points.
+        float* position = &mPositions[level][vertex * FLOATS_PER_VERTEX];
+        position[0]     = 2.0f * levels[level][p] / windowWidth - 1.0f;
+        position[1]     = 2.0f * levels[level][p + 1] / windowHeight - 1.0f;
+      }
+    }
+  }
+}
+
+bool MiniHudMeshModel::isValid() const
+{
+  return mVertexCount > 0;
+}
+
+uint32_t MiniHudMeshModel::vertexCount() const
+{
+  return mVertexCount;
+}
+
+uint32_t MiniHudMeshModel::levelCount() const
+{
+  return static_cast<uint32_t>(mPositions.size());
+}
+
+bool MiniHudMeshModel::isCoarse(uint32_t region) const
+{
+  return region < mCoarse.size() && mCoarse[region];
+}
+
+uint32_t MiniHudMeshModel::coarseRegionCount() const
+{
+  return static_cast<uint32_t>(std::count(mCoarse.begin(), mCoarse.end(), true));
+}
+
+float MiniHudMeshModel::estimatedErrorPixels() const
+{
+  return mEstimatedErrorPixels;
+}
+
+void MiniHudMeshModel::evaluate(float mirrorLevel, float* out) const
+{
+  const BasisWeights basis = basisWeights(mirrorLevel, levelCount());
+
+  const float* texCoords = mTexCoords.data();
+  const float* level0    = mPositions[basis.levels[0]].data();
+  const float* level1    = mPositions[basis.levels[1]].data();
+  const float* level2    = mPositions[basis.levels[2]].data();
+  const float* level3    = mPositions[basis.levels[3]].data();
+
+  // Flat loop over interleaved data, vectorized by the compiler. The cost does not depend on the number of levels.
+  const uint32_t count = mVertexCount * FLOATS_PER_VERTEX;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    out[i] = texCoords[i] + basis.weights[0] * level0[i] + basis.weights[1] * level1[i] +
+             basis.weights[2] * level2[i] + basis.weights[3] * level3[i];
+  }
+}
+
+/**
+ * The mesh is a weighted sum of the levels, so every coordinate lies within the same weighted sum of the level
+ * bounds. The Catmull-Rom weights can be negative, those take the opposite bound.
+ */
+std::array<float, 4> MiniHudMeshModel::bounds(float mirrorLevel) const
+{
+  std::array<float, 4> result{};
+  if (mBounds.empty())
+  {
+    return result;
+  }
+
+  const BasisWeights basis = basisWeights(mirrorLevel, levelCount());
+  for (uint32_t i = 0; i < BASIS_SIZE; i++)
+  {
+    const std::array<float, 4>& level  = mBounds[basis.levels[i]];
+    const float                 weight = basis.weights[i];
+    const bool                  sign   = weight >= 0.0f;
+    result[0] += weight * (sign ? level[0] : level[2]);
+    result[1] += weight * (sign ? level[1] : level[3]);
+    result[2] += weight * (sign ? level[2] : level[0]);
+    result[3] += weight * (sign ? level[3] : level[1]);
+  }
+  return result;
+}
@@ -0,0 +1,148 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Evaluates the warped mini HUD mesh on the CPU.
+ *
+ * The client sends one grid of 21x9 control points per calibrated mirror level. Every region of the mini HUD is
+ * covered by a 3x3 cell mesh whose vertices sit on a 4x4 block of that grid. The model keeps the control points
+ * of every vertex of all regions per level, already transformed to normalized device coordinates, so that the
+ * mesh for a mirror level is a plain weighted sum of those arrays.
+ *
+ * Regions whose control points all lie within the tolerated error of the two triangles spanned by their corners
+ * are coarse: they are drawn with a single cell instead of 3x3.
+ */
+class MiniHudMeshModel final
+{
+public:
+  static constexpr uint32_t PARAMETER_GRID_X = 21;
+  static constexpr uint32_t PARAMETER_GRID_Y = 9;
+  static constexpr uint32_t PARAMETER_COUNT  = PARAMETER_GRID_X * PARAMETER_GRID_Y * 2;
+
+  /**
+   * @brief The calibrated levels are spread evenly over this mirror level range.
+   */
+  static constexpr float MIRROR_LEVEL_MIN = 0.0f;
+  static constexpr float MIRROR_LEVEL_MAX = 10.0f;
+
+  /**
+   * @brief Number of calibrated levels contributing to any mirror level.
+   */
+  static constexpr uint32_t BASIS_SIZE = 4;
+
+  static constexpr uint32_t REGION_CELLS          = 3;
+  static constexpr uint32_t REGION_CONTROL_POINTS = REGION_CELLS + 1;
+  static constexpr uint32_t REGION_VERTEX_COUNT   = REGION_CELLS * REGION_CELLS * 6;
+  static constexpr uint32_t COARSE_VERTEX_COUNT   = 6;
+  static constexpr uint32_t REGION_COLUMNS        = 7;
+  static constexpr uint32_t REGION_ROWS           = 3;
+  static constexpr uint32_t REGION_COUNT          = REGION_COLUMNS * REGION_ROWS;
+
+  /**
+   * @brief Layout of one vertex of the evaluated mesh: position in normalized device coordinates followed by the
+   * texture coordinate, matching KWin::GLVertex2D.
+   */
+  static constexpr uint32_t FLOATS_PER_VERTEX = 4;
+
+  using Parameters = std::array<float, PARAMETER_COUNT>;
+
+  struct Region
+  {
+    uint32_t             x;
+    uint32_t             y;
+    std::array<float, 4> uvSpan;
+  };
+
+  /**
+   * @brief Sparse interpolation weights of the calibrated levels for one mirror level. Unused entries have weight 0.
+   */
+  struct BasisWeights
+  {
+    std::array<int32_t, BASIS_SIZE> levels;
+    std::array<float, BASIS_SIZE>   weights;
+  };
+
+  /**
+   * @brief Returns the position in [0, 1] x [0, 1] of a vertex of the mesh shared by all regions with the given
+   * number of cells per side.
+   */
+  static std::array<float, 2> unitVertex(uint32_t vertex, uint32_t cells = REGION_CELLS);
+
+  /**
+   * @brief Returns the REGION_COUNT regions covering the parameter grid with their texture coordinates.
+   *
+   * @param[in] contentArea The app area in texture coordinates: left, top, right, bottom.
+   */
+  static std::vector<Region> layoutRegions(const std::array<float, 4>& contentArea);
+
+  /**
+   * @brief Returns the mirror level the parameter set with the given index is calibrated for.
+   */
+  static float calibrationLevel(uint32_t index, uint32_t levelCount);
+
+  /**
+   * @brief Returns the interpolation weights of the calibrated levels for the given mirror level.
+   */
+  static BasisWeights basisWeights(float mirrorLevel, uint32_t levelCount);
+
+  void setup(const std::vector<Region>&     regions,
+             const std::vector<Parameters>& levels,
+             float                          windowWidth,
+             float                          windowHeight,
+             float                          maxErrorPixels);
+
+  bool     isValid() const;
+  uint32_t vertexCount() const;
+  uint32_t levelCount() const;
+
+  /**
+   * @brief Returns whether the region with the given index is drawn with a single cell.
+   */
+  bool     isCoarse(uint32_t region) const;
+  uint32_t coarseRegionCount() const;
+
+  /**
+   * @brief Returns the largest distance in pixels of a control point from the mesh it is drawn with.
+   */
+  float    estimatedErrorPixels() const;
+
+  /**
+   * @brief Writes the warped mesh for the given mirror level.
+   *
+   * @param[in] mirrorLevel The mirror level to evaluate.
+   * @param[out] out Destination of vertexCount() * FLOATS_PER_VERTEX floats.
+   */
+  void evaluate(float mirrorLevel, float* out) const;
+
+  /**
+   * @brief Returns bounds of the warped mesh for the given mirror level in normalized device coordinates: min x,
+   * min y, max x, max y. They hold for the full 3x3 cell mesh of every region, coarse or not.
+   */
+  std::array<float, 4> bounds(float mirrorLevel) const;
+
+private:
+  uint32_t mVertexCount         = 0;
+  float    mEstimatedErrorPixels = 0.0f;
+  std::vector<bool> mCoarse;
+
+  /**
+   * @brief Per vertex (0, 0, u, v).
+   */
+  std::vector<float> mTexCoords;
+
+  /**
+   * @brief Per level and vertex (x, y, 0, 0) in normalized device coordinates.
+   */
+  std::vector<std::vector<float>> mPositions;
+
+  /**
+   * @brief Per level bounds of all control points of the regions in normalized device coordinates.
+   */
+  std::vector<std::array<float, 4>> mBounds;
+};
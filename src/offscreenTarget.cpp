@@ -0,0 +1,380 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "offscreenTarget.h"
+
+#include <core/output.h>
+#include <core/rendertarget.h>
+#include <core/renderviewport.h>
+#include <effect/effecthandler.h>
+#include <opengl/glframebuffer.h>
+#include <opengl/gltexture.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "kwinarhud_debug.h"
+
+namespace KWin
+{
+
+OffscreenFormat offscreenFormatFromName(const QString& name)
+{
+    if (name.compare(QStringLiteral("RGB565"), Qt::CaseInsensitive) == 0)
+    {
+        return OffscreenFormat::RGB565;
+    }
+    if (name.compare(QStringLiteral("RGB10_A2"), Qt::CaseInsensitive) == 0)
+    {
+        return OffscreenFormat::RGB10_A2;
+    }
+    if (!name.isEmpty() && name.compare(QStringLiteral("RGBA8"), Qt::CaseInsensitive) != 0)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Unknown offscreen format" << name << "- using RGBA8";
+    }
+    return OffscreenFormat::RGBA8;
+}
+
+QString offscreenFormatName(OffscreenFormat format)
+{
+    switch (format)
+    {
+    case OffscreenFormat::RGB565:
+        return QStringLiteral("RGB565");
+    case OffscreenFormat::RGB10_A2:
+        return QStringLiteral("RGB10_A2");
+    case OffscreenFormat::RGBA8:
+        break;
+    }
+    return QStringLiteral("RGBA8");
+}
+
+GLenum offscreenInternalFormat(OffscreenFormat format)
+{
+    switch (format)
+    {
+    case OffscreenFormat::RGB565:
+        return GL_RGB565;
+    case OffscreenFormat::RGB10_A2:
+        return GL_RGB10_A2;
+    case OffscreenFormat::RGBA8:
+        break;
+    }
+    return GL_RGBA8;
+}
+
+uint32_t offscreenBytesPerPixel(OffscreenFormat format)
+{
+    return format == OffscreenFormat::RGB565 ? 2 : 4;
+}
+
+/**
+ * Creates an immutable texture of the given format and size, the only way to get a narrow format on GLES
+ * where GLTexture::allocate() always picks RGBA8.
+ */
+static GLuint createTextureStorage(OffscreenFormat format, const QSize& size)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    if (texture == 0)
+    {
+        return 0;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, offscreenInternalFormat(format), size.width(), size.height());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+bool clearGlErrors()
+{
+    // Every call clears one of the few error flags, but a lost context keeps reporting GL_CONTEXT_LOST.
+    constexpr int maxErrorFlags = 16;
+    for (int flag = 0; flag < maxErrorFlags; flag++)
+    {
+        if (glGetError() == GL_NO_ERROR)
+        {
+            return true;
+        }
+    }
+    qCWarning(KWINARHUD_DEBUG) << "clearGlErrors: GL keeps reporting errors, the context may be lost";
+    return false;
+}
+
+bool OffscreenFormatSupport::isRenderable(OffscreenFormat format)
+{
+    int8_t& result = m_renderable[static_cast<size_t>(format)];
+    if (result < 0)
+    {
+        if (!clearGlErrors())
+        {
+            // Probed again once the context recovered.
+            return false;
+        }
+
+        GLint previousFramebuffer = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+        const GLuint texture = createTextureStorage(format, QSize(1, 1));
+        GLuint framebuffer = 0;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+        result = texture != 0 && glGetError() == GL_NO_ERROR
+                         && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE
+                     ? 1
+                     : 0;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &texture);
+
+        qCInfo(KWINARHUD_DEBUG) << "Offscreen format" << offscreenFormatName(format) << (result ? "is" : "is not") << "renderable";
+    }
+    return result > 0;
+}
+
+std::unique_ptr<GLTexture> allocateOffscreenTexture(OffscreenFormat format,
+                                                    const QSize& size,
+                                                    uint32_t refreshRate,
+                                                    OffscreenFormatSupport& support)
+{
+    if (format == OffscreenFormat::RGB565 && !support.isRenderable(format))
+    {
+        format = OffscreenFormat::RGB10_A2;
+    }
+    if (format == OffscreenFormat::RGB10_A2 && !support.isRenderable(format))
+    {
+        format = OffscreenFormat::RGBA8;
+    }
+
+    const GLuint texture = createTextureStorage(format, size);
+    if (texture == 0)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "allocateOffscreenTexture failed: could not create texture";
+        return nullptr;
+    }
+
+    // Estimate only: the scene writes every pixel at least once and the warp reads it back once. Overdraw, blending and
+    // framebuffer compression are not accounted for.
+    const double bytesPerFrame = 2.0 * size.width() * size.height() * offscreenBytesPerPixel(format);
+    qCInfo(KWINARHUD_DEBUG) << "Offscreen target" << offscreenFormatName(format) << size
+                            << "- estimated traffic" << bytesPerFrame / 1.0e6 << "MB per frame,"
+                            << bytesPerFrame * refreshRate / 1.0e12 << "GB/s";
+
+    return std::make_unique<GLTexture>(GL_TEXTURE_2D, texture, offscreenInternalFormat(format), size, 1, true);
+}
+
+uint64_t offscreenTextureBytes(const GLTexture& texture)
+{
+    const uint64_t bytesPerPixel = texture.internalFormat() == GL_RGB565 ? 2 : 4;
+    return bytesPerPixel * static_cast<uint64_t>(texture.width()) * static_cast<uint64_t>(texture.height());
+}
+
+OffscreenRing::~OffscreenRing()
+{
+    for (Slot& slot : m_slots)
+    {
+        free(slot);
+    }
+}
+
+void OffscreenRing::free(Slot& slot)
+{
+    if (slot.fence)
+    {
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+    // The driver keeps the texture alive until the GPU is done with it.
+    slot.framebuffer.reset();
+    slot.texture.reset();
+    slot.bytes = 0;
+}
+
+void OffscreenRing::setDepth(uint32_t depth)
+{
+    depth = std::clamp(depth, 1u, MAX_DEPTH);
+    if (depth == m_depth)
+    {
+        return;
+    }
+    for (uint32_t index = depth; index < MAX_DEPTH; index++)
+    {
+        free(m_slots[index]);
+    }
+    m_depth = depth;
+    m_current = std::min(m_current, depth - 1);
+}
+
+uint32_t OffscreenRing::depth() const
+{
+    return m_depth;
+}
+
+bool OffscreenRing::acquire(OffscreenFormat format, const QSize& size, uint32_t refreshRate)
+{
+    m_current = (m_current + 1) % m_depth;
+    Slot& slot = m_slots[m_current];
+
+    if (slot.fence)
+    {
+        // Normally signaled long ago, otherwise the GPU waits instead of the compositor thread.
+        if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            glWaitSync(slot.fence, 0, GL_TIMEOUT_IGNORED);
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+
+    return allocate(m_current, format, size, refreshRate);
+}
+
+void OffscreenRing::prepare(OffscreenFormat format, const QSize& size, uint32_t refreshRate)
+{
+    // The current slot may still be warped again, it follows once it is acquired next.
+    for (uint32_t index = 0; index < m_depth; index++)
+    {
+        if (index != m_current)
+        {
+            allocate(index, format, size, refreshRate);
+        }
+    }
+}
+
+bool OffscreenRing::allocate(uint32_t index, OffscreenFormat format, const QSize& size, uint32_t refreshRate)
+{
+    Slot& slot = m_slots[index];
+    if (slot.texture && slot.texture->size() == size && slot.format == format)
+    {
+        return true;
+    }
+
+    qCInfo(KWINARHUD_DEBUG) << "Allocating offscreen slot" << index << "of" << m_depth << "with size" << size;
+    // The driver keeps the old texture alive until a pending warp sampling it is done.
+    free(slot);
+    slot.texture = allocateOffscreenTexture(format, size, refreshRate, m_formatSupport);
+    if (!slot.texture)
+    {
+        return false;
+    }
+    slot.format = format;
+    slot.bytes = offscreenTextureBytes(*slot.texture);
+    slot.texture->setFilter(GL_LINEAR);
+    slot.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    slot.framebuffer = std::make_unique<GLFramebuffer>(slot.texture.get());
+
+    slot.texture->bind();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    slot.texture->unbind();
+    return true;
+}
+
+void OffscreenRing::release()
+{
+    Slot& slot = m_slots[m_current];
+    if (!slot.texture)
+    {
+        return;
+    }
+    if (slot.fence)
+    {
+        glDeleteSync(slot.fence);
+    }
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool OffscreenRing::isReusable(OffscreenFormat format, const QSize& size) const
+{
+    const Slot& slot = m_slots[m_current];
+    return slot.texture && slot.texture->size() == size && slot.format == format;
+}
+
+GLTexture* OffscreenRing::texture() const
+{
+    return m_slots[m_current].texture.get();
+}
+
+GLFramebuffer* OffscreenRing::framebuffer() const
+{
+    return m_slots[m_current].framebuffer.get();
+}
+
+uint64_t OffscreenRing::bytes() const
+{
+    uint64_t bytes = 0;
+    for (const Slot& slot : m_slots)
+    {
+        bytes += slot.bytes;
+    }
+    return bytes;
+}
+
+QRect sampledPixelRect(const QRectF& uvRect, const QSize& size)
+{
+    if (uvRect.isEmpty())
+    {
+        return QRect(0, 0, size.width(), size.height());
+    }
+
+    const int left = std::clamp(static_cast<int>(std::floor(uvRect.left() * size.width())) - 1, 0, size.width());
+    const int top = std::clamp(static_cast<int>(std::floor(uvRect.top() * size.height())) - 1, 0, size.height());
+    const int right = std::clamp(static_cast<int>(std::ceil(uvRect.right() * size.width())) + 1, 0, size.width());
+    const int bottom = std::clamp(static_cast<int>(std::ceil(uvRect.bottom() * size.height())) + 1, 0, size.height());
+
+    if (right <= left || bottom <= top)
+    {
+        return QRect(0, 0, size.width(), size.height());
+    }
+    return QRect(left, top, right - left, bottom - top);
+}
+
+QSize scaledTargetSize(const QRect& sourceRect, double renderScale)
+{
+    return QSize(std::max(1, static_cast<int>(std::lround(sourceRect.width() * renderScale))),
+                 std::max(1, static_cast<int>(std::lround(sourceRect.height() * renderScale))));
+}
+
+const QRegion& ClippedRegionCache::clip(const QRegion& region, const QRect& area)
+{
+    // Comparing walks the rectangles of both regions, assigning only shares the data of the region.
+    if (area != m_area || region != m_region)
+    {
+        m_region = region;
+        m_area = area;
+        m_clipped = region.intersected(area);
+    }
+    return m_clipped;
+}
+
+void paintScreenArea(GLFramebuffer* framebuffer,
+                     const QRect& sourceRect,
+                     double renderScale,
+                     const RenderTarget& renderTarget,
+                     const RenderViewport& viewport,
+                     int mask,
+                     const QRegion& region,
+                     Output* screen,
+                     ClippedRegionCache& regionCache)
+{
+    const double scale = viewport.scale();
+    const QRectF logicalRect(screen->geometry().x() + sourceRect.x() / scale,
+                             screen->geometry().y() + sourceRect.y() / scale,
+                             sourceRect.width() / scale,
+                             sourceRect.height() / scale);
+
+    // The projection of this viewport maps the source rectangle onto the whole framebuffer.
+    const RenderTarget areaTarget(framebuffer, renderTarget.colorDescription());
+    const RenderViewport areaViewport(logicalRect, scale * renderScale, areaTarget);
+
+    GLFramebuffer::pushFramebuffer(framebuffer);
+    effects->paintScreen(areaTarget, areaViewport, mask, regionCache.clip(region, logicalRect.toAlignedRect()), screen);
+    GLFramebuffer::popFramebuffer();
+}
+
+} // namespace KWin
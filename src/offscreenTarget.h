@@ -0,0 +1,206 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QRect>
+#include <QRectF>
+#include <QRegion>
+#include <QSize>
+#include <QString>
+
+#include <epoxy/gl.h>
+#include <array>
+#include <memory>
+
+namespace KWin
+{
+
+class GLFramebuffer;
+class GLTexture;
+class Output;
+class RenderTarget;
+class RenderViewport;
+
+/**
+ * Color formats of the offscreen texture the HUD scene is rendered into before warping.
+ * The projectors cannot show more than the RGB565 colour depth, narrower formats save memory bandwidth.
+ */
+enum class OffscreenFormat
+{
+    RGBA8,
+    RGB10_A2,
+    RGB565,
+};
+
+/**
+ * Parses a format name as used in WarpingConstants.json, unknown names fall back to RGBA8.
+ */
+OffscreenFormat offscreenFormatFromName(const QString& name);
+QString offscreenFormatName(OffscreenFormat format);
+GLenum offscreenInternalFormat(OffscreenFormat format);
+uint32_t offscreenBytesPerPixel(OffscreenFormat format);
+
+/**
+ * Clears the pending GL errors before a call whose error is checked. Returns false if the errors do not stop coming,
+ * which a lost context does.
+ */
+bool clearGlErrors();
+
+/**
+ * Which offscreen formats the driver can render into, probed once per format on first use. Every effect owns one
+ * through its OffscreenRing, so the results are dropped together with the GL context they were probed in.
+ */
+class OffscreenFormatSupport
+{
+public:
+    bool isRenderable(OffscreenFormat format);
+
+private:
+    // -1: not probed yet
+    std::array<int8_t, 3> m_renderable{ { -1, -1, -1 } };
+};
+
+/**
+ * Allocates the offscreen texture. A format the driver cannot render into is replaced by the next wider one, down to
+ * RGBA8. The memory traffic of the target is estimated from its size and logged, it is not measured.
+ *
+ * @param[in] format The requested format.
+ * @param[in] size The size of the texture in pixels.
+ * @param[in] refreshRate The refresh rate of the output in mHz, used for the traffic estimate.
+ * @param[in] support The formats the driver of the current context can render into.
+ */
+std::unique_ptr<GLTexture> allocateOffscreenTexture(OffscreenFormat format,
+                                                    const QSize& size,
+                                                    uint32_t refreshRate,
+                                                    OffscreenFormatSupport& support);
+
+/**
+ * Returns the memory of an offscreen texture in bytes, with the format it was actually allocated in.
+ */
+uint64_t offscreenTextureBytes(const GLTexture& texture);
+
+/**
+ * Offscreen targets the effect renders the scene of consecutive frames into in turn, so that the scene pass of a frame
+ * does not have to wait for the GPU to finish sampling the target of the previous frame in its warp.
+ *
+ * Every slot is fenced after the warp that samples it. A slot is (re)allocated when it comes up again with another
+ * size or format, so a resize spreads the allocations over the next frames instead of replacing all targets at once.
+ */
+class OffscreenRing
+{
+public:
+    static constexpr uint32_t MAX_DEPTH = 3;
+
+    OffscreenRing() = default;
+    ~OffscreenRing();
+
+    OffscreenRing(const OffscreenRing&) = delete;
+    OffscreenRing& operator=(const OffscreenRing&) = delete;
+
+    /**
+     * Sets the number of slots, clamped to 1 .. MAX_DEPTH. Slots beyond it are freed.
+     */
+    void setDepth(uint32_t depth);
+    uint32_t depth() const;
+
+    /**
+     * Advances to the next slot and makes sure it has the given format and size. If the GPU still samples the slot,
+     * the following GL commands are ordered after that instead of blocking the CPU.
+     *
+     * @return Whether the slot has a target, false if the allocation failed.
+     */
+    bool acquire(OffscreenFormat format, const QSize& size, uint32_t refreshRate);
+
+    /**
+     * (Re)allocates every slot but the current one with the given format and size ahead of the frames that acquire
+     * them, for changes that are known outside of a frame.
+     */
+    void prepare(OffscreenFormat format, const QSize& size, uint32_t refreshRate);
+
+    /**
+     * Fences the current slot, to be called once the warp sampling it has been submitted.
+     */
+    void release();
+
+    /**
+     * Returns whether the current slot holds a target of the given format and size, which can be warped again without
+     * acquiring the next slot and rendering the scene.
+     */
+    bool isReusable(OffscreenFormat format, const QSize& size) const;
+
+    GLTexture* texture() const;
+    GLFramebuffer* framebuffer() const;
+
+    /**
+     * Memory of all allocated slots in bytes.
+     */
+    uint64_t bytes() const;
+
+private:
+    struct Slot
+    {
+        std::unique_ptr<GLTexture> texture;
+        std::unique_ptr<GLFramebuffer> framebuffer;
+        OffscreenFormat format = OffscreenFormat::RGBA8;
+        uint64_t bytes = 0;
+        GLsync fence = nullptr;
+    };
+
+    static void free(Slot& slot);
+    bool allocate(uint32_t index, OffscreenFormat format, const QSize& size, uint32_t refreshRate);
+
+    std::array<Slot, MAX_DEPTH> m_slots;
+    OffscreenFormatSupport m_formatSupport;
+    uint32_t m_depth = 2;
+    uint32_t m_current = 0;
+};
+
+/**
+ * Returns the pixels of an area of the given size the warp samples from, grown by one pixel for the footprint of the
+ * linear filter. An empty uv rectangle results in the whole area.
+ *
+ * @param[in] uvRect The sampled rectangle in texture coordinates of the whole area.
+ * @param[in] size The size of the whole area in pixels.
+ */
+QRect sampledPixelRect(const QRectF& uvRect, const QSize& size);
+
+/**
+ * Repaint region clipped to the offscreen area. The HUD repaints the same region every frame, so the clipped region
+ * is kept instead of building a new QRegion on the heap per frame.
+ */
+class ClippedRegionCache
+{
+public:
+    const QRegion& clip(const QRegion& region, const QRect& area);
+
+private:
+    QRegion m_region;
+    QRect m_area;
+    QRegion m_clipped;
+};
+
+/**
+ * Renders the part sourceRect of the screen into the framebuffer, which has the size of sourceRect multiplied by
+ * renderScale. Only windows overlapping it get painted.
+ *
+ * @param[in] sourceRect The rectangle in device pixels of the screen.
+ * @param[in] renderScale The resolution of the framebuffer relative to the screen.
+ * @param[in] regionCache The region of the previous frame of the effect, see ClippedRegionCache.
+ */
+void paintScreenArea(GLFramebuffer* framebuffer,
+                     const QRect& sourceRect,
+                     double renderScale,
+                     const RenderTarget& renderTarget,
+                     const RenderViewport& viewport,
+                     int mask,
+                     const QRegion& region,
+                     Output* screen,
+                     ClippedRegionCache& regionCache);
+
+/**
+ * Returns the size of the offscreen texture for the source rectangle rendered at the given scale.
+ */
+QSize scaledTargetSize(const QRect& sourceRect, double renderScale);
+
+} // namespace KWin
@@ -0,0 +1,382 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "performanceOverlay.h"
+#include "frameBudgetGovernor.h"
+#include "shaderVariants.h"
+#include "warpingStatistics.h"
+
+#include <opengl/glframebuffer.h>
+#include <opengl/glvertexbuffer.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "kwinarhud_debug.h"
+
+namespace KWin
+{
+
+namespace
+{
+
+struct Glyph
+{
+    char character;
+    // One row per byte from the top, bit 4 is the leftmost column.
+    std::array<uint8_t, 7> rows;
+};
+
+// clang-format off
+constexpr Glyph s_font[] = {
+    { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+    { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+    { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+    { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+    { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+    { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+    { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+    { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+    { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+    { ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+    { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+    { '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+    { '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+    { 'A', { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 } },
+    { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+    { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+    { 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+    { 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+    { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+    { 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+    { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+    { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+    { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+    { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+    { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+    { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+    { 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+    { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+    { 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+    { 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+    { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+    { 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+    { 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+};
+// clang-format on
+
+constexpr int s_glyphWidth = 5;
+constexpr int s_glyphHeight = 7;
+// One blank texel column and row around every glyph, so that nearest sampling never reaches the neighbour cell.
+constexpr int s_cellWidth = s_glyphWidth + 1;
+constexpr int s_cellHeight = s_glyphHeight + 1;
+
+// Screen pixels per font texel and the layout of the panel in pixels of the offscreen target.
+constexpr float s_textScale = 2.0f;
+constexpr float s_advance = s_cellWidth * s_textScale;
+constexpr float s_lineHeight = (s_cellHeight + 1) * s_textScale;
+constexpr float s_margin = 8.0f;
+constexpr float s_padding = 8.0f;
+constexpr float s_barWidth = 5.0f;
+constexpr float s_barGap = 1.0f;
+constexpr float s_graphHeight = 48.0f;
+constexpr uint32_t s_graphFrames = 64;
+constexpr uint32_t s_textLines = 5;
+constexpr uint32_t s_textColumns = 28;
+constexpr float s_graphWidth = s_graphFrames * (s_barWidth + s_barGap);
+constexpr float s_panelWidth = std::max(s_textColumns * s_advance, s_graphWidth) + 2.0f * s_padding;
+constexpr float s_panelHeight = s_textLines * s_lineHeight + s_padding + s_graphHeight + 2.0f * s_padding;
+
+// Premultiplied RGBA of the swatches, in the order of PerformanceOverlay::Swatch.
+constexpr std::array<std::array<uint8_t, 4>, 5> s_swatchColors = { {
+    { 0, 0, 0, 255 },
+    { 255, 255, 255, 255 },
+    { 40, 200, 80, 255 },
+    { 230, 200, 40, 255 },
+    { 230, 50, 40, 255 },
+} };
+
+const char* tierLabel(FrameBudgetGovernor::Tier tier)
+{
+    switch (tier)
+    {
+    case FrameBudgetGovernor::Tier::Full:
+        return "FULL";
+    case FrameBudgetGovernor::Tier::CoarseMesh:
+        return "COARSE";
+    case FrameBudgetGovernor::Tier::ReducedScale:
+        return "REDUCED";
+    case FrameBudgetGovernor::Tier::NearestFilter:
+        return "NEAREST";
+    }
+    return "";
+}
+
+} // namespace
+
+PerformanceOverlay::PerformanceOverlay() = default;
+
+PerformanceOverlay::~PerformanceOverlay()
+{
+    if (m_atlas != 0)
+    {
+        glDeleteTextures(1, &m_atlas);
+    }
+}
+
+bool PerformanceOverlay::initialize()
+{
+    m_initialized = true;
+
+    m_program = loadShaderVariant(QStringLiteral(":/effects/arhud/shaders/performance_overlay_core.vert"),
+                                  QStringLiteral(":/effects/arhud/shaders/performance_overlay_core.frag"),
+                                  {});
+    if (!m_program)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Performance overlay shader is not valid, the overlay stays off";
+        m_failed = true;
+        return false;
+    }
+    m_targetSizeLocation = m_program->uniformLocation("targetSize");
+    m_atlasLocation = m_program->uniformLocation("atlas");
+
+    // Cell 0 is blank, the glyphs follow and the swatches come last.
+    const uint32_t glyphCount = static_cast<uint32_t>(std::size(s_font));
+    m_cellCount = 1 + glyphCount + static_cast<uint32_t>(Swatch::Count);
+    const int width = static_cast<int>(m_cellCount) * s_cellWidth;
+    std::vector<uint8_t> texels(static_cast<size_t>(width * s_cellHeight * 4), 0);
+
+    const auto fillTexel = [&texels, width](int x, int y, const std::array<uint8_t, 4>& color) {
+        std::copy(color.begin(), color.end(), texels.begin() + (y * width + x) * 4);
+    };
+    for (uint32_t glyph = 0; glyph < glyphCount; glyph++)
+    {
+        const int cellX = static_cast<int>(1 + glyph) * s_cellWidth;
+        for (int y = 0; y < s_glyphHeight; y++)
+        {
+            for (int x = 0; x < s_glyphWidth; x++)
+            {
+                if (s_font[glyph].rows[y] & (0x10 >> x))
+                {
+                    fillTexel(cellX + x, y, s_swatchColors[static_cast<size_t>(Swatch::Text)]);
+                }
+            }
+        }
+        m_glyphCells[static_cast<uint8_t>(s_font[glyph].character)] = static_cast<uint8_t>(1 + glyph);
+    }
+    for (uint32_t swatch = 0; swatch < static_cast<uint32_t>(Swatch::Count); swatch++)
+    {
+        const int cellX = static_cast<int>(1 + glyphCount + swatch) * s_cellWidth;
+        for (int y = 0; y < s_cellHeight; y++)
+        {
+            for (int x = 0; x < s_cellWidth; x++)
+            {
+                fillTexel(cellX + x, y, s_swatchColors[swatch]);
+            }
+        }
+    }
+
+    glGenTextures(1, &m_atlas);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, s_cellHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_vbo = std::make_unique<GLVertexBuffer>(GLVertexBuffer::UsageHint::Stream);
+    const GLVertexAttrib attribs[] = {
+        { VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position) },
+        { VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord) },
+    };
+    m_vbo->setAttribLayout(attribs, sizeof(GLVertex2D));
+
+    qCInfo(KWINARHUD_DEBUG) << "Performance overlay enabled";
+    return true;
+}
+
+void PerformanceOverlay::appendQuad(float x, float y, float width, float height, uint32_t cell, float cellWidth, float cellHeight)
+{
+    if (m_vertexCount + 6 > s_maxVertices)
+    {
+        return;
+    }
+
+    const float atlasWidth = static_cast<float>(m_cellCount * s_cellWidth);
+    const float u0 = static_cast<float>(cell * s_cellWidth) / atlasWidth;
+    const float u1 = (static_cast<float>(cell * s_cellWidth) + cellWidth) / atlasWidth;
+    const float v0 = 0.0f;
+    const float v1 = cellHeight / static_cast<float>(s_cellHeight);
+
+    const GLVertex2D corners[] = {
+        { QVector2D(x, y), QVector2D(u0, v0) },
+        { QVector2D(x + width, y), QVector2D(u1, v0) },
+        { QVector2D(x + width, y + height), QVector2D(u1, v1) },
+        { QVector2D(x, y + height), QVector2D(u0, v1) },
+    };
+    for (const int corner : { 0, 1, 2, 0, 2, 3 })
+    {
+        m_vertices[m_vertexCount++] = corners[corner];
+    }
+}
+
+void PerformanceOverlay::appendSwatch(float x, float y, float width, float height, Swatch swatch)
+{
+    const uint32_t cell = 1 + static_cast<uint32_t>(std::size(s_font)) + static_cast<uint32_t>(swatch);
+    appendQuad(x, y, width, height, cell, s_cellWidth, s_cellHeight);
+}
+
+void PerformanceOverlay::appendText(float x, float y, const char* text)
+{
+    for (const char* character = text; *character != '\0'; character++, x += s_advance)
+    {
+        const auto code = static_cast<unsigned char>(*character);
+        const uint32_t cell = code < m_glyphCells.size() ? m_glyphCells[code] : 0;
+        if (cell != 0)
+        {
+            appendQuad(x, y, s_glyphWidth * s_textScale, s_glyphHeight * s_textScale, cell, s_glyphWidth, s_glyphHeight);
+        }
+    }
+}
+
+bool PerformanceOverlay::takeDrawn()
+{
+    return std::exchange(m_drawn, false);
+}
+
+void PerformanceOverlay::draw(GLFramebuffer* target, const WarpingStatistics& statistics, const FrameBudgetGovernor& governor)
+{
+    if (!target || m_failed || (!m_initialized && !initialize()))
+    {
+        return;
+    }
+
+    const auto map = m_vbo->map<GLVertex2D>(s_maxVertices);
+    if (!map)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "PerformanceOverlay::draw failed: GLVertexBuffer::map() returned nullptr";
+        return;
+    }
+    m_vertices = map->data();
+    m_vertexCount = 0;
+
+    std::array<float, s_graphFrames> frameTimes{};
+    const uint32_t frames = statistics.latest(WarpingStatistics::Timing::FrameCpu, frameTimes);
+    std::array<float, 1> warpCpu{};
+    std::array<float, 1> frameGpu{};
+    const bool hasWarpCpu = statistics.latest(WarpingStatistics::Timing::WarpCpu, warpCpu) > 0;
+    const bool hasFrameGpu = statistics.latest(WarpingStatistics::Timing::FrameGpu, frameGpu) > 0;
+
+    appendSwatch(s_margin, s_margin, s_panelWidth, s_panelHeight, Swatch::Background);
+
+    // Text is formatted into a fixed buffer, the overlay does not allocate per frame.
+    char line[s_textColumns + 1];
+    float y = s_margin + s_padding;
+    const float x = s_margin + s_padding;
+
+    std::snprintf(line, sizeof(line), "FRAME %6.2f MS %s", frames > 0 ? frameTimes[frames - 1] / 1000.0 : 0.0,
+                  tierLabel(governor.tier()));
+    appendText(x, y, line);
+    y += s_lineHeight;
+
+    std::snprintf(line, sizeof(line), "WARP CPU %5.2f GPU %5.2f MS", hasWarpCpu ? warpCpu[0] / 1000.0 : 0.0,
+                  hasFrameGpu ? frameGpu[0] / 1000.0 : 0.0);
+    appendText(x, y, line);
+    y += s_lineHeight;
+
+    const double poseAge = statistics.poseAge();
+    if (poseAge < 0.0)
+    {
+        std::snprintf(line, sizeof(line), "POSE -");
+    }
+    else
+    {
+        std::snprintf(line, sizeof(line), "POSE AGE %6.1f MS %4.0f HZ", poseAge / 1000.0, statistics.poseRate());
+    }
+    appendText(x, y, line);
+    y += s_lineHeight;
+
+    // A red marker while frames were skipped since the previous overlay.
+    const uint64_t skipped = statistics.framesSkipped();
+    std::snprintf(line, sizeof(line), "SKIPPED %llu", static_cast<unsigned long long>(skipped));
+    appendText(x, y, line);
+    if (skipped > m_framesSkipped)
+    {
+        appendSwatch(x + (s_textColumns - 1) * s_advance, y, s_glyphWidth * s_textScale, s_glyphHeight * s_textScale,
+                     Swatch::OverBudget);
+    }
+    m_framesSkipped = skipped;
+    y += s_lineHeight;
+
+    // A green marker while frames only warped the previous offscreen target since the previous overlay.
+    const uint64_t reprojected = statistics.framesReprojected();
+    std::snprintf(line, sizeof(line), "REPROJECTED %llu", static_cast<unsigned long long>(reprojected));
+    appendText(x, y, line);
+    if (reprojected > m_framesReprojected)
+    {
+        appendSwatch(x + (s_textColumns - 1) * s_advance, y, s_glyphWidth * s_textScale, s_glyphHeight * s_textScale,
+                     Swatch::WithinBudget);
+    }
+    m_framesReprojected = reprojected;
+    y += s_lineHeight + s_padding;
+
+    // Frame time graph of the last frames, the budget line at two thirds of the height.
+    const double budget = governor.budget().count() > 0 ? static_cast<double>(governor.budget().count()) : 1.0e6 / 60.0;
+    const float graphBottom = y + s_graphHeight;
+    const float budgetHeight = s_graphHeight * 2.0f / 3.0f;
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        const double ratio = frameTimes[frame] / budget;
+        const float height = std::clamp(static_cast<float>(ratio) * budgetHeight, 1.0f, s_graphHeight);
+        const Swatch swatch = ratio > 1.0 ? Swatch::OverBudget : ratio > 0.75 ? Swatch::NearBudget : Swatch::WithinBudget;
+        const float barX = x + static_cast<float>(s_graphFrames - frames + frame) * (s_barWidth + s_barGap);
+        appendSwatch(barX, graphBottom - height, s_barWidth, height, swatch);
+    }
+    appendSwatch(x, graphBottom - budgetHeight, s_graphWidth, 1.0f, Swatch::Text);
+
+    m_vbo->unmap();
+    m_vertices = nullptr;
+
+    const QSize size = target->size();
+    GLFramebuffer::pushFramebuffer(target);
+
+    const GLboolean blend = glIsEnabled(GL_BLEND);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+
+    m_program->bind();
+    m_program->setUniform(m_targetSizeLocation, QVector2D(static_cast<float>(size.width()), static_cast<float>(size.height())));
+    m_program->setUniform(m_atlasLocation, 0);
+
+    m_vbo->bindArrays();
+    m_vbo->draw(GL_TRIANGLES, 0, static_cast<int>(m_vertexCount));
+    m_vbo->unbindArrays();
+
+    m_program->unbind();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (!blend)
+    {
+        glDisable(GL_BLEND);
+    }
+
+    GLFramebuffer::popFramebuffer();
+    m_drawn = true;
+}
+
+} // namespace KWin
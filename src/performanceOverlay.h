@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <epoxy/gl.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+namespace KWin
+{
+
+class FrameBudgetGovernor;
+class GLFramebuffer;
+class GLVertexBuffer;
+class ShaderProgram;
+class WarpingStatistics;
+struct GLVertex2D;
+
+/**
+ * Frame time graph, warp CPU and GPU time, pose age, skipped and reprojected frames drawn into the offscreen target
+ * before the warp, so that they reach the projector warped like the content. Meant for bench debugging, see
+ * PERFORMANCE_OVERLAY.
+ *
+ * The whole overlay is one draw of streamed quads textured from a small atlas that holds the glyphs of an embedded
+ * 5x7 font and the colour swatches. The atlas and the program are only created on the first draw.
+ */
+class PerformanceOverlay
+{
+public:
+    PerformanceOverlay();
+    ~PerformanceOverlay();
+
+    PerformanceOverlay(const PerformanceOverlay&) = delete;
+    PerformanceOverlay& operator=(const PerformanceOverlay&) = delete;
+
+    /**
+     * Draws the overlay into the top left corner of target, over what the scene rendered there. Shows the values of
+     * the previous frames, the warp of the current one has not happened yet. The panel is opaque, so a reprojected
+     * frame can draw it again into the target it reuses.
+     */
+    void draw(GLFramebuffer* target, const WarpingStatistics& statistics, const FrameBudgetGovernor& governor);
+
+    /**
+     * Returns whether draw() drew since the previous call. A target it drew into keeps the overlay until the scene
+     * renders into it again.
+     */
+    bool takeDrawn();
+
+private:
+    enum class Swatch : uint32_t
+    {
+        Background,
+        Text,
+        WithinBudget,
+        NearBudget,
+        OverBudget,
+        Count,
+    };
+
+    bool initialize();
+    void appendQuad(float x, float y, float width, float height, uint32_t cell, float cellWidth, float cellHeight);
+    void appendSwatch(float x, float y, float width, float height, Swatch swatch);
+    void appendText(float x, float y, const char* text);
+
+    static constexpr uint32_t s_maxVertices = 2048;
+
+    std::unique_ptr<ShaderProgram> m_program;
+    std::unique_ptr<GLVertexBuffer> m_vbo;
+    GLuint m_atlas = 0;
+    int m_targetSizeLocation = -1;
+    int m_atlasLocation = -1;
+    bool m_initialized = false;
+    bool m_failed = false;
+    bool m_drawn = false;
+
+    // Atlas cell of every ASCII character, 0 is the blank cell.
+    std::array<uint8_t, 128> m_glyphCells{};
+    uint32_t m_cellCount = 0;
+
+    // Vertices of the frame being built, points into the mapped vertex buffer.
+    GLVertex2D* m_vertices = nullptr;
+    uint32_t m_vertexCount = 0;
+
+    uint64_t m_framesSkipped = 0;
+    uint64_t m_framesReprojected = 0;
+};
+
+} // namespace KWin
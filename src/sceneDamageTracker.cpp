@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "sceneDamageTracker.h"
+
+#include <effect/effecthandler.h>
+#include <effect/effectwindow.h>
+
+namespace KWin
+{
+
+SceneDamageTracker::SceneDamageTracker(QObject* parent)
+    : QObject(parent)
+{
+    const auto windows = effects->stackingOrder();
+    for (EffectWindow* window : windows)
+    {
+        watch(window);
+    }
+    connect(effects, &EffectsHandler::windowAdded, this, [this](EffectWindow* window) {
+        watch(window);
+        sceneChanged();
+    });
+    connect(effects, &EffectsHandler::windowClosed, this, &SceneDamageTracker::sceneChanged);
+    connect(effects, &EffectsHandler::windowDeleted, this, &SceneDamageTracker::sceneChanged);
+    connect(effects, &EffectsHandler::stackingOrderChanged, this, &SceneDamageTracker::sceneChanged);
+    connect(effects, &EffectsHandler::virtualScreenGeometryChanged, this, &SceneDamageTracker::sceneChanged);
+}
+
+SceneDamageTracker::~SceneDamageTracker() = default;
+
+void SceneDamageTracker::watch(EffectWindow* window)
+{
+    connect(window, &EffectWindow::windowDamaged, this, &SceneDamageTracker::windowDamaged);
+    connect(window, &EffectWindow::windowExpandedGeometryChanged, this, &SceneDamageTracker::sceneChanged);
+    connect(window, &EffectWindow::windowOpacityChanged, this, &SceneDamageTracker::sceneChanged);
+    connect(window, &EffectWindow::windowShown, this, &SceneDamageTracker::sceneChanged);
+    connect(window, &EffectWindow::windowHidden, this, &SceneDamageTracker::sceneChanged);
+    connect(window, &EffectWindow::minimizedChanged, this, &SceneDamageTracker::sceneChanged);
+}
+
+void SceneDamageTracker::windowDamaged(EffectWindow* window)
+{
+    m_damage = m_damage.united(window->expandedGeometry().toAlignedRect());
+}
+
+void SceneDamageTracker::sceneChanged()
+{
+    m_full = true;
+    m_changed = std::chrono::steady_clock::now();
+}
+
+void SceneDamageTracker::invalidate()
+{
+    m_full = true;
+}
+
+bool SceneDamageTracker::takeDamage(const QRect& area)
+{
+    // Fullscreen effects paint the scene without damaging any window.
+    const bool settling = std::chrono::steady_clock::now() - m_changed < s_settleTime;
+    const bool damaged = m_full || settling || effects->hasActiveFullScreenEffect() || m_damage.intersects(area);
+    m_damage = QRect();
+    m_full = false;
+    return damaged;
+}
+
+} // namespace KWin
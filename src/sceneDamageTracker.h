@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QObject>
+#include <QRect>
+
+#include <chrono>
+
+namespace KWin
+{
+
+class EffectWindow;
+
+/**
+ * Collects what changed in the scene since the last offscreen render of a HUD, so that a frame whose content is
+ * unchanged only warps the previous offscreen target with the new pose.
+ *
+ * Damage of a window is tracked by its geometry. Windows appearing, disappearing, moving or restacking may be
+ * animated by other effects without any damage, those changes count as damage of the whole scene for a settle time.
+ */
+class SceneDamageTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SceneDamageTracker(QObject* parent = nullptr);
+    ~SceneDamageTracker() override;
+
+    /**
+     * Returns whether the scene may look different within area, in logical coordinates, since the last call, and
+     * starts collecting anew.
+     */
+    bool takeDamage(const QRect& area);
+
+    /**
+     * Damages the whole scene, e.g. when the offscreen target no longer holds the last render.
+     */
+    void invalidate();
+
+private:
+    void watch(EffectWindow* window);
+    void windowDamaged(EffectWindow* window);
+    void sceneChanged();
+
+    static constexpr std::chrono::milliseconds s_settleTime{ 1000 };
+
+    QRect m_damage;
+    bool m_full = true;
+    std::chrono::steady_clock::time_point m_changed{};
+};
+
+} // namespace KWin
@@ -0,0 +1,302 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "shaderProgram.h"
+
+#include <opengl/glvertexbuffer.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cstring>
+
+#include "kwinarhud_debug.h"
+
+namespace KWin
+{
+
+static bool programBinariesSupported()
+{
+    // Drivers may support GL_PROGRAM_BINARY without a single binary format, nothing can be cached then.
+    static const bool supported = []() {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }();
+    return supported;
+}
+
+static QString programCachePath(const QByteArray& vertexSource, const QByteArray& fragmentSource)
+{
+    // A binary is only valid for the driver that produced it, an update of the driver changes the version string.
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        hash.addData(QByteArray(reinterpret_cast<const char*>(glGetString(name))));
+        hash.addData(QByteArray(1, '\0'));
+    }
+    hash.addData(vertexSource);
+    hash.addData(QByteArray(1, '\0'));
+    hash.addData(fragmentSource);
+
+    const QDir directory(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+                         + QStringLiteral("/kwin-arhud/programs"));
+    return directory.filePath(QString::fromLatin1(hash.result().toHex()) + QStringLiteral(".bin"));
+}
+
+static bool isLinked(GLuint program)
+{
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
+
+static GLuint loadProgramBinary(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return 0;
+    }
+    const QByteArray data = file.readAll();
+    GLenum format = 0;
+    if (data.size() <= static_cast<qsizetype>(sizeof(format)))
+    {
+        return 0;
+    }
+    std::memcpy(&format, data.constData(), sizeof(format));
+
+    const GLuint program = glCreateProgram();
+    glProgramBinary(program, format, data.constData() + sizeof(format), static_cast<GLsizei>(data.size() - sizeof(format)));
+    if (!isLinked(program))
+    {
+        // Rejected binaries are expected after driver updates that keep the version string.
+        qCInfo(KWINARHUD_DEBUG) << "Cached program" << path << "was rejected by the driver";
+        glDeleteProgram(program);
+        QFile::remove(path);
+        return 0;
+    }
+    return program;
+}
+
+static void storeProgramBinary(GLuint program, const QString& path)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    GLenum format = 0;
+    QByteArray data(static_cast<qsizetype>(sizeof(format)) + length, Qt::Uninitialized);
+    glGetProgramBinary(program, length, &length, &format, data.data() + sizeof(format));
+    std::memcpy(data.data(), &format, sizeof(format));
+    data.resize(static_cast<qsizetype>(sizeof(format)) + length);
+
+    if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Failed to create the program cache directory for" << path;
+        return;
+    }
+    // QSaveFile never leaves a truncated binary behind if the compositor stops while writing.
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Failed to write the program cache" << path << file.errorString();
+    }
+}
+
+static GLuint compileShader(GLenum type, const QByteArray& source)
+{
+    const GLuint shader = glCreateShader(type);
+    const char* data = source.constData();
+    const GLint length = static_cast<GLint>(source.size());
+    glShaderSource(shader, 1, &data, &length);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        GLint logLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        QByteArray log(std::max(logLength, 1), '\0');
+        glGetShaderInfoLog(shader, logLength, nullptr, log.data());
+        qCWarning(KWINARHUD_DEBUG) << "Failed to compile" << (type == GL_VERTEX_SHADER ? "vertex" : "fragment")
+                                   << "shader:" << log.constData();
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint compileProgram(const QByteArray& vertexSource, const QByteArray& fragmentSource)
+{
+    const GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    const GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vertexShader || !fragmentShader)
+    {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    const GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, VA_Position, "position");
+    glBindAttribLocation(program, VA_TexCoord, "texcoord");
+    if (programBinariesSupported())
+    {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    if (!isLinked(program))
+    {
+        GLint logLength = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+        QByteArray log(std::max(logLength, 1), '\0');
+        glGetProgramInfoLog(program, logLength, nullptr, log.data());
+        qCWarning(KWINARHUD_DEBUG) << "Failed to link program:" << log.constData();
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+std::unique_ptr<ShaderProgram> ShaderProgram::create(const QByteArray& vertexSource, const QByteArray& fragmentSource)
+{
+    const bool cacheable = programBinariesSupported();
+    const QString path = cacheable ? programCachePath(vertexSource, fragmentSource) : QString();
+
+    GLuint program = cacheable ? loadProgramBinary(path) : 0;
+    if (program)
+    {
+        qCDebug(KWINARHUD_DEBUG) << "Loaded cached program" << path;
+    }
+    else
+    {
+        program = compileProgram(vertexSource, fragmentSource);
+        if (!program)
+        {
+            return nullptr;
+        }
+        if (cacheable)
+        {
+            storeProgramBinary(program, path);
+        }
+    }
+    return std::unique_ptr<ShaderProgram>(new ShaderProgram(program));
+}
+
+ShaderProgram::ShaderProgram(GLuint program)
+    : m_program(program)
+{
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    glDeleteProgram(m_program);
+}
+
+int ShaderProgram::uniformLocation(const char* name) const
+{
+    return glGetUniformLocation(m_program, name);
+}
+
+bool ShaderProgram::bindUniformBlock(const char* name, GLuint binding)
+{
+    const GLuint index = glGetUniformBlockIndex(m_program, name);
+    if (index == GL_INVALID_INDEX)
+    {
+        return false;
+    }
+    glUniformBlockBinding(m_program, index, binding);
+    return true;
+}
+
+void ShaderProgram::bind()
+{
+    // KWin tracks its own programs in the ShaderManager, it binds them again on the next push.
+    glGetIntegerv(GL_CURRENT_PROGRAM, &m_previousProgram);
+    glUseProgram(m_program);
+}
+
+void ShaderProgram::unbind()
+{
+    glUseProgram(static_cast<GLuint>(m_previousProgram));
+    m_previousProgram = 0;
+}
+
+bool ShaderProgram::setUniform(int location, int value)
+{
+    if (location < 0)
+    {
+        return false;
+    }
+    glUniform1i(location, value);
+    return true;
+}
+
+bool ShaderProgram::setUniform(int location, float value)
+{
+    if (location < 0)
+    {
+        return false;
+    }
+    glUniform1f(location, value);
+    return true;
+}
+
+bool ShaderProgram::setUniform(int location, const QVector2D& value)
+{
+    if (location < 0)
+    {
+        return false;
+    }
+    glUniform2f(location, value.x(), value.y());
+    return true;
+}
+
+bool ShaderProgram::setUniform(int location, const QVector3D& value)
+{
+    if (location < 0)
+    {
+        return false;
+    }
+    glUniform3f(location, value.x(), value.y(), value.z());
+    return true;
+}
+
+bool ShaderProgram::setUniform(int location, const QVector4D& value)
+{
+    if (location < 0)
+    {
+        return false;
+    }
+    glUniform4f(location, value.x(), value.y(), value.z(), value.w());
+    return true;
+}
+
+bool ShaderProgram::setUniform(int location, const QMatrix4x4& value)
+{
+    if (location < 0)
+    {
+        return false;
+    }
+    glUniformMatrix4fv(location, 1, GL_FALSE, value.constData());
+    return true;
+}
+
+} // namespace KWin
@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QByteArray>
+#include <QMatrix4x4>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector4D>
+
+#include <epoxy/gl.h>
+
+#include <memory>
+
+namespace KWin
+{
+
+/**
+ * A linked GL program of the warping effects.
+ *
+ * Unlike GLShader the program is linked from a binary in the on-disk program cache when one matches the driver and
+ * the sources, compiling the sources only on a cache miss. The attribute locations match the ones of GLVertexBuffer.
+ */
+class ShaderProgram
+{
+public:
+    /**
+     * Links the program from the cache or compiles the sources, nullptr if both fail.
+     */
+    static std::unique_ptr<ShaderProgram> create(const QByteArray& vertexSource, const QByteArray& fragmentSource);
+
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    bool isValid() const { return m_program != 0; }
+    int uniformLocation(const char* name) const;
+
+    /**
+     * Assigns the uniform block name to the binding point, false if the program has no such block.
+     */
+    bool bindUniformBlock(const char* name, GLuint binding);
+
+    /**
+     * Makes the program current, unbind() restores the program that was current before.
+     */
+    void bind();
+    void unbind();
+
+    bool setUniform(int location, int value);
+    bool setUniform(int location, float value);
+    bool setUniform(int location, const QVector2D& value);
+    bool setUniform(int location, const QVector3D& value);
+    bool setUniform(int location, const QVector4D& value);
+    bool setUniform(int location, const QMatrix4x4& value);
+
+private:
+    explicit ShaderProgram(GLuint program);
+
+    GLuint m_program;
+    GLint m_previousProgram = 0;
+};
+
+} // namespace KWin
@@ -0,0 +1,86 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "shaderVariants.h"
+
+#include <opengl/glframebuffer.h>
+#include <opengl/glvertexbuffer.h>
+
+#include <QFile>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace KWin
+{
+
+static QByteArray readShaderSource(const QString& fileName, const std::vector<QByteArray>& defines)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Failed to read shader" << fileName;
+        return QByteArray();
+    }
+    QByteArray source = file.readAll();
+
+    QByteArray header;
+    for (const QByteArray& define : defines)
+    {
+        header.append("#define ").append(define).append("\n");
+    }
+
+    // #version has to stay the first statement.
+    const qsizetype version = source.indexOf("#version");
+    const qsizetype lineEnd = version < 0 ? -1 : source.indexOf('\n', version);
+    source.insert(lineEnd + 1, header);
+    return source;
+}
+
+std::unique_ptr<ShaderProgram> loadShaderVariant(const QString& vertexFile, const QString& fragmentFile, const std::vector<QByteArray>& defines)
+{
+    const QByteArray vertexSource = readShaderSource(vertexFile, defines);
+    const QByteArray fragmentSource = readShaderSource(fragmentFile, defines);
+    if (vertexSource.isEmpty() || fragmentSource.isEmpty())
+    {
+        return nullptr;
+    }
+    return ShaderProgram::create(vertexSource, fragmentSource);
+}
+
+void prewarmPrograms(GLFramebuffer* target, const std::vector<ShaderProgram*>& programs)
+{
+    if (!target || programs.empty())
+    {
+        return;
+    }
+
+    // Three equal vertices, the triangle has no area and nothing is rasterized.
+    GLVertexBuffer vbo(GLVertexBuffer::UsageHint::Static);
+    const GLVertexAttrib attribs[] = {
+        {VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position)},
+        {VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord)},
+    };
+    vbo.setAttribLayout(attribs, sizeof(GLVertex2D));
+    const auto map = vbo.map<GLVertex2D>(3);
+    if (!map)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "prewarmPrograms failed: GLVertexBuffer::map() returned nullptr";
+        return;
+    }
+    std::fill(map->begin(), map->end(), GLVertex2D{});
+    vbo.unmap();
+
+    GLFramebuffer::pushFramebuffer(target);
+    vbo.bindArrays();
+    for (ShaderProgram* program : programs)
+    {
+        program->bind();
+        vbo.draw(GL_TRIANGLES, 0, 3);
+        program->unbind();
+    }
+    vbo.unbindArrays();
+    GLFramebuffer::popFramebuffer();
+}
+
+} // namespace KWin
@@ -0,0 +1,117 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "kwinarhud_debug.h"
+#include "shaderProgram.h"
+
+namespace KWin
+{
+
+/**
+ * Loads a shader pair from the resources with one #define per entry of defines injected after the #version line.
+ * The linked program is taken from the on-disk program cache when the driver accepts the cached binary.
+ */
+std::unique_ptr<ShaderProgram> loadShaderVariant(const QString& vertexFile, const QString& fragmentFile, const std::vector<QByteArray>& defines);
+
+class GLFramebuffer;
+
+/**
+ * Issues one degenerate draw per program into target. Drivers that defer the final compilation or the state
+ * validation of a program to its first draw then do it here instead of in the first frame that needs the program.
+ */
+void prewarmPrograms(GLFramebuffer* target, const std::vector<ShaderProgram*>& programs);
+
+/**
+ * Compiles specialized variants of a shader pair on first use and caches them by the bit mask of their features.
+ * Bit i of the key enables the #define features[i]. The uniform locations of a variant are resolved once when it is
+ * compiled.
+ */
+template<typename Uniforms>
+class ShaderVariantCache
+{
+public:
+    struct Variant
+    {
+        std::unique_ptr<ShaderProgram> shader;
+        Uniforms uniforms{};
+    };
+    using Resolver = std::function<Uniforms(ShaderProgram*)>;
+
+    ShaderVariantCache(const QString& vertexFile, const QString& fragmentFile, std::vector<QByteArray> features, Resolver resolver)
+        : m_vertexFile(vertexFile)
+        , m_fragmentFile(fragmentFile)
+        , m_features(std::move(features))
+        , m_resolver(std::move(resolver))
+    {
+    }
+
+    /**
+     * Returns the variant with the features of key, nullptr if it does not compile. A failed variant is not retried.
+     */
+    const Variant* variant(uint32_t key)
+    {
+        auto it = m_variants.find(key);
+        if (it == m_variants.end())
+        {
+            std::vector<QByteArray> defines;
+            for (size_t feature = 0; feature < m_features.size(); feature++)
+            {
+                if (key & (1u << feature))
+                {
+                    defines.push_back(m_features[feature]);
+                }
+            }
+
+            Variant variant;
+            variant.shader = loadShaderVariant(m_vertexFile, m_fragmentFile, defines);
+            if (variant.shader && variant.shader->isValid())
+            {
+                variant.uniforms = m_resolver(variant.shader.get());
+                qCInfo(KWINARHUD_DEBUG) << "Loaded shader variant" << m_vertexFile << "with key" << key;
+            }
+            else
+            {
+                qCWarning(KWINARHUD_DEBUG) << "Shader variant" << m_vertexFile << "with key" << key << "is not valid";
+                variant.shader.reset();
+            }
+            it = m_variants.emplace(key, std::move(variant)).first;
+        }
+        return it->second.shader ? &it->second : nullptr;
+    }
+
+    /**
+     * Loads the variants of keys ahead of the first frame that uses them and returns the valid ones.
+     */
+    std::vector<ShaderProgram*> preload(const std::vector<uint32_t>& keys)
+    {
+        std::vector<ShaderProgram*> programs;
+        for (uint32_t key : keys)
+        {
+            if (const Variant* loaded = variant(key))
+            {
+                programs.push_back(loaded->shader.get());
+            }
+        }
+        return programs;
+    }
+
+private:
+    QString m_vertexFile;
+    QString m_fragmentFile;
+    std::vector<QByteArray> m_features;
+    Resolver m_resolver;
+    std::unordered_map<uint32_t, Variant> m_variants;
+};
+
+} // namespace KWin
@@ -0,0 +1,21 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MBition GmbH
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#version 300 es
+
+precision highp float;
+precision highp int;
+precision lowp sampler2D;
+precision lowp samplerCube;
+
+in vec2 texCoord;
+out vec4 fragColor;
+
+// Glyphs and colour swatches with premultiplied alpha, see PerformanceOverlay.
+uniform sampler2D atlas;
+
+void main() {
+    fragColor = texture(atlas, texCoord);
+}
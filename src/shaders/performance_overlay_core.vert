@@ -0,0 +1,23 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MBition GmbH
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#version 300 es
+
+precision highp float;
+precision highp int;
+precision lowp sampler2D;
+precision lowp samplerCube;
+
+// Overlay vertices in pixels of the offscreen target with the origin at the top left, like the scene.
+in vec2 position;
+in vec2 texcoord;
+out vec2 texCoord;
+
+uniform vec2 targetSize;
+
+void main() {
+    texCoord = texcoord;
+    gl_Position = vec4(position.x / targetSize.x * 2.0 - 1.0, 1.0 - position.y / targetSize.y * 2.0, 0.0, 1.0);
+}
@@ -11,19 +11,33 @@ precision highp int;
 precision lowp sampler2D;
 precision lowp samplerCube;
 
-in vec2 position;
 in vec2 texcoord;
 out vec2 texCoord0;
 
-//uniform mat4 qt_Matrix;
-uniform mat4 modelViewProjectionMatrix;
-uniform sampler2D warpingMatrixTexture;
-uniform int matrixCount;
-uniform vec2 matrixResolution;
-uniform float matrixInterpolationFactor;
-uniform int matrixInterpolationIndex;
-uniform vec4 uvFunc;
+// Variants, see ClassicArHudEffect::paintScreen():
+// SINGLE_MATRIX: matrixInterpolationIndex is used without interpolation.
+// BICUBIC_INTERPOLATION: Catmull-Rom instead of bilinear interpolation between the matrix nodes.
+// FLOAT_MATRIX_TEXTURE: the matrices are stored as RG32F with one texel per node instead of encoded RGBA8.
+uniform highp sampler2D warpingMatrixTexture;
+// Only uploaded when the offscreen target or the calibration changes, see WarpParametersBuffer.
+layout(std140) uniform WarpParameters
+{
+  vec4 uvFunc;
+  vec2 matrixResolution;
+};
+// Written by the CPU as late as possible before the GPU executes the draw, see HeadPoseBuffer.
+layout(std140) uniform HeadPose
+{
+  int matrixInterpolationIndex;
+  float matrixInterpolationFactor;
+};
 
+#ifdef FLOAT_MATRIX_TEXTURE
+vec2 GetNodeSSPos(int mIndex, ivec2 node)
+{
+  return texelFetch(warpingMatrixTexture, ivec2(node.x, node.y + mIndex * int(matrixResolution.y)), 0).rg;
+}
+#else
 float ConvertToFloat(vec4 v)
 {
   uvec4 uv = clamp(uvec4(round(v * 255.0f)), 0U, 255U);
@@ -32,26 +46,75 @@ float ConvertToFloat(vec4 v)
   return f * 4.0f - 2.0f;
 }
 
+vec2 GetNodeSSPos(int mIndex, ivec2 node)
+{
+  int row = node.y + mIndex * int(matrixResolution.y);
+
+  return vec2(ConvertToFloat(texelFetch(warpingMatrixTexture, ivec2(2 * node.x, row), 0).xyzw),
+     ConvertToFloat(texelFetch(warpingMatrixTexture, ivec2(2 * node.x + 1, row), 0).xyzw));
+}
+#endif
+
+#ifdef BICUBIC_INTERPOLATION
+// Catmull-Rom weights of the nodes cell - 1 .. cell + 2, see Matrix::sampleBicubic().
+vec4 CatmullRomWeights(float t)
+{
+  float t2 = t * t;
+  float t3 = t2 * t;
+  return 0.5f * vec4(-t + 2.0f * t2 - t3, 2.0f - 5.0f * t2 + 3.0f * t3, t + 4.0f * t2 - 3.0f * t3, -t2 + t3);
+}
+#endif
+
+// The mesh places vertices between the nodes of the matrix as well, those are interpolated bilinearly or bicubically.
 vec2 GetVertexSSPos(int mIndex)
 {
-  float cu = float(matrixResolution.x) * 2.0f;
-  float cv = float(matrixResolution.y);
+  vec2 grid = texcoord * (matrixResolution - 1.0f);
+  grid = mix(grid, round(grid), lessThan(abs(grid - round(grid)), vec2(1.0e-3)));
+
+  ivec2 cell = min(ivec2(floor(grid)), ivec2(matrixResolution) - 2);
+  vec2 f = grid - vec2(cell);
+
+  if (f == vec2(0.0f))
+  {
+    return GetNodeSSPos(mIndex, cell);
+  }
 
-  float u0 =  (texcoord.x * (cu - 2.0f) + 0.5f) / cu;
-  float v  = ((texcoord.y * (cv - 1.0f) + 0.5f) / cv + float(mIndex)) / float(matrixCount);
+#ifdef BICUBIC_INTERPOLATION
+  ivec2 maxNode = ivec2(matrixResolution) - 1;
+  vec4 wx = CatmullRomWeights(f.x);
+  vec4 wy = CatmullRomWeights(f.y);
 
-  float u1 = u0 + 1.0f / cu;
+  vec2 ssPos = vec2(0.0f);
+  for (int j = 0; j < 4; j++)
+  {
+    vec2 row = vec2(0.0f);
+    for (int i = 0; i < 4; i++)
+    {
+      row += wx[i] * GetNodeSSPos(mIndex, clamp(cell + ivec2(i - 1, j - 1), ivec2(0), maxNode));
+    }
+    ssPos += wy[j] * row;
+  }
+  return ssPos;
+#else
+  vec2 p00 = GetNodeSSPos(mIndex, cell);
+  vec2 p10 = GetNodeSSPos(mIndex, cell + ivec2(1, 0));
+  vec2 p01 = GetNodeSSPos(mIndex, cell + ivec2(0, 1));
+  vec2 p11 = GetNodeSSPos(mIndex, cell + ivec2(1, 1));
 
-  return vec2(ConvertToFloat(textureLod(warpingMatrixTexture, vec2(u0, v), 0.0f).xyzw),
-     ConvertToFloat(textureLod(warpingMatrixTexture, vec2(u1, v), 0.0f).xyzw));
+  return mix(mix(p00, p10, f.x), mix(p01, p11, f.x), f.y);
+#endif
 }
 
 void main()
 {
+#ifdef SINGLE_MATRIX
+  vec2 ssPos = GetVertexSSPos(matrixInterpolationIndex);
+#else
   vec2 ssPos = mix(
   GetVertexSSPos(matrixInterpolationIndex),
   GetVertexSSPos(matrixInterpolationIndex + 1),
   matrixInterpolationFactor);
+#endif
 
   texCoord0 = texcoord * uvFunc.xy + uvFunc.zw;
 
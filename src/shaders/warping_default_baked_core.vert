@@ -0,0 +1,21 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MBition GmbH
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#version 300 es
+
+precision highp float;
+precision highp int;
+precision lowp sampler2D;
+precision lowp samplerCube;
+
+// Mesh evaluated on the CPU for the current mirror level, see MiniHudMeshModel.
+in vec2 position;
+in vec2 texcoord;
+out vec2 texCoord;
+
+void main() {
+    texCoord = texcoord;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
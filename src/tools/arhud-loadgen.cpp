@@ -0,0 +1,626 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Wayland client that streams synthetic workloads through zmbition_warped_output_manager_v1 and
+// mbition_mini_hud_warping_manager_v1 and reports the round trip latencies it observes. Every batch of requests is
+// followed by a wl_display_sync, its done event arrives once the compositor has processed the whole batch.
+
+#include "MiniHudMeshModel.hxx"
+
+#include "wayland-mbition-mini-hud-warping-unstable-v1-client-protocol.h"
+#include "wayland-mbition-warped-output-unstable-v1-client-protocol.h"
+
+#include <wayland-client.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+enum class Workload : uint32_t
+{
+    HeadPose,
+    Recalibration,
+    MirrorLevel,
+    Count
+};
+
+constexpr std::array<const char*, static_cast<size_t>(Workload::Count)> WORKLOAD_NAMES = {
+    {"head pose", "recalibration", "mirror level"}};
+
+/**
+ * Display and calibration sizes the compositor expects, see WarpingConstants.json.
+ */
+struct Layout
+{
+    uint32_t displayWidth  = 1920;
+    uint32_t displayHeight = 720;
+    uint32_t appAreaWidth  = 1920;
+    uint32_t appAreaHeight = 720;
+    uint32_t matrixCount   = 3;
+    uint32_t matrixWidth   = 10;
+    uint32_t matrixHeight  = 10;
+};
+
+struct Settings
+{
+    Layout   layout;
+    double   duration              = 10.0;
+    double   headPoseRate          = 60.0;
+    double   recalibrationInterval = 0.0;
+    uint32_t recalibrationBurst    = 1;
+    bool     classicHud            = true;
+    bool     miniHud               = false;
+    uint32_t mirrorLevels          = 3;
+    double   mirrorRate            = 10.0;
+    double   mirrorSweepPeriod     = 2.0;
+};
+
+struct Statistics
+{
+    uint64_t            requests = 0;
+    uint64_t            skipped  = 0;
+    std::vector<double> latencies;
+};
+
+class LoadGenerator
+{
+public:
+    LoadGenerator(wl_display* display, const Settings& settings)
+        : m_display(display)
+        , m_settings(settings)
+    {
+    }
+
+    ~LoadGenerator()
+    {
+        for (auto& [callback, pending] : m_pending)
+        {
+            wl_callback_destroy(callback);
+        }
+        if (m_miniHud)
+        {
+            mbition_mini_hud_warping_v1_destroy(m_miniHud);
+        }
+        if (m_warpedOutput)
+        {
+            zmbition_warped_output_v1_destroy(m_warpedOutput);
+        }
+        if (m_miniHudManager)
+        {
+            mbition_mini_hud_warping_manager_v1_destroy(m_miniHudManager);
+        }
+        if (m_warpedOutputManager)
+        {
+            zmbition_warped_output_manager_v1_destroy(m_warpedOutputManager);
+        }
+        if (m_output)
+        {
+            wl_output_destroy(m_output);
+        }
+        if (m_registry)
+        {
+            wl_registry_destroy(m_registry);
+        }
+    }
+
+    LoadGenerator(const LoadGenerator&) = delete;
+    LoadGenerator& operator=(const LoadGenerator&) = delete;
+
+    bool connect(QTextStream& err)
+    {
+        static const wl_registry_listener registryListener = {&LoadGenerator::global, &LoadGenerator::globalRemove};
+        m_registry = wl_display_get_registry(m_display);
+        wl_registry_add_listener(m_registry, &registryListener, this);
+        wl_display_roundtrip(m_display);
+
+        if (m_settings.classicHud)
+        {
+            if (!m_warpedOutputManager || !m_output)
+            {
+                err << "The compositor does not announce zmbition_warped_output_manager_v1 and wl_output" << Qt::endl;
+                return false;
+            }
+            m_warpedOutput = zmbition_warped_output_manager_v1_get_warped_output(m_warpedOutputManager, m_output);
+        }
+        if (m_settings.miniHud)
+        {
+            if (!m_miniHudManager)
+            {
+                err << "The compositor does not announce mbition_mini_hud_warping_manager_v1" << Qt::endl;
+                return false;
+            }
+            const Layout& layout = m_settings.layout;
+            m_miniHud = mbition_mini_hud_warping_manager_v1_get_mini_hud(
+                m_miniHudManager, layout.displayWidth, layout.displayHeight, layout.appAreaWidth, layout.appAreaHeight);
+        }
+        return wl_display_roundtrip(m_display) >= 0;
+    }
+
+    bool run(QTextStream& err)
+    {
+        const Clock::time_point start = Clock::now();
+        const Clock::time_point end   = start + toDuration(m_settings.duration);
+
+        std::array<Clock::time_point, static_cast<size_t>(Workload::Count)> due;
+        std::array<Clock::duration, static_cast<size_t>(Workload::Count)>   period;
+        period[index(Workload::HeadPose)]      = m_warpedOutput ? toPeriod(m_settings.headPoseRate) : Clock::duration::zero();
+        period[index(Workload::Recalibration)] = toDuration(m_settings.recalibrationInterval);
+        period[index(Workload::MirrorLevel)]   = m_miniHud ? toPeriod(m_settings.mirrorRate) : Clock::duration::zero();
+
+        // The first calibration goes out right away, the effects draw nothing without one.
+        recalibrate();
+
+        for (size_t workload = 0; workload < due.size(); workload++)
+        {
+            due[workload] = period[workload] > Clock::duration::zero() ? start + period[workload] : end;
+        }
+
+        while (true)
+        {
+            const Clock::time_point now = Clock::now();
+            if (now >= end)
+            {
+                break;
+            }
+
+            for (size_t workload = 0; workload < due.size(); workload++)
+            {
+                if (due[workload] > now)
+                {
+                    continue;
+                }
+                send(static_cast<Workload>(workload), std::chrono::duration<double>(now - start).count());
+
+                // A client that falls behind drops updates rather than sending them in a burst.
+                due[workload] += period[workload];
+                if (due[workload] <= now)
+                {
+                    const auto missed = (now - due[workload]) / period[workload] + 1;
+                    m_statistics[workload].skipped += static_cast<uint64_t>(missed);
+                    due[workload] += missed * period[workload];
+                }
+            }
+
+            if (!dispatch(std::min(*std::min_element(due.begin(), due.end()), end), err))
+            {
+                return false;
+            }
+        }
+
+        // Collects the done events of the batches still in flight.
+        if (wl_display_roundtrip(m_display) < 0)
+        {
+            err << "Connection to the compositor failed: " << std::strerror(wl_display_get_error(m_display)) << Qt::endl;
+            return false;
+        }
+        m_elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        return true;
+    }
+
+    void report(QTextStream& out) const
+    {
+        out << "workload         requests  skipped    rate Hz     p50 us     p99 us     max us" << Qt::endl;
+        for (size_t workload = 0; workload < m_statistics.size(); workload++)
+        {
+            const Statistics& statistics = m_statistics[workload];
+            if (statistics.requests == 0)
+            {
+                continue;
+            }
+            std::vector<double> latencies = statistics.latencies;
+            std::sort(latencies.begin(), latencies.end());
+            auto percentile = [&latencies](double fraction) {
+                return latencies.empty() ? 0.0 : latencies[static_cast<size_t>(fraction * static_cast<double>(latencies.size() - 1))];
+            };
+
+            out << QString::fromLatin1(WORKLOAD_NAMES[workload]).leftJustified(14)
+                << QString::number(statistics.requests).rightJustified(11) << QString::number(statistics.skipped).rightJustified(9)
+                << QString::number(static_cast<double>(statistics.requests) / m_elapsed, 'f', 1).rightJustified(11)
+                << QString::number(percentile(0.5), 'f', 1).rightJustified(11)
+                << QString::number(percentile(0.99), 'f', 1).rightJustified(11)
+                << QString::number(percentile(1.0), 'f', 1).rightJustified(11) << Qt::endl;
+        }
+    }
+
+private:
+    static size_t index(Workload workload) { return static_cast<size_t>(workload); }
+
+    static Clock::duration toDuration(double seconds)
+    {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(std::max(seconds, 0.0)));
+    }
+
+    static Clock::duration toPeriod(double rate) { return rate > 0.0 ? toDuration(1.0 / rate) : Clock::duration::zero(); }
+
+    static void global(void* data, wl_registry* registry, uint32_t name, const char* interface, uint32_t /*version*/)
+    {
+        auto* generator = static_cast<LoadGenerator*>(data);
+        if (std::strcmp(interface, wl_output_interface.name) == 0 && !generator->m_output)
+        {
+            generator->m_output = static_cast<wl_output*>(wl_registry_bind(registry, name, &wl_output_interface, 1));
+        }
+        else if (std::strcmp(interface, zmbition_warped_output_manager_v1_interface.name) == 0)
+        {
+            generator->m_warpedOutputManager = static_cast<zmbition_warped_output_manager_v1*>(
+                wl_registry_bind(registry, name, &zmbition_warped_output_manager_v1_interface, 1));
+        }
+        else if (std::strcmp(interface, mbition_mini_hud_warping_manager_v1_interface.name) == 0)
+        {
+            generator->m_miniHudManager = static_cast<mbition_mini_hud_warping_manager_v1*>(
+                wl_registry_bind(registry, name, &mbition_mini_hud_warping_manager_v1_interface, 1));
+        }
+    }
+
+    static void globalRemove(void* /*data*/, wl_registry* /*registry*/, uint32_t /*name*/) {}
+
+    static void syncDone(void* data, wl_callback* callback, uint32_t /*serial*/)
+    {
+        auto*      generator = static_cast<LoadGenerator*>(data);
+        const auto pending   = generator->m_pending.find(callback);
+        if (pending != generator->m_pending.end())
+        {
+            const double latency = std::chrono::duration<double, std::micro>(Clock::now() - pending->second.sent).count();
+            generator->m_statistics[index(pending->second.workload)].latencies.push_back(latency);
+            generator->m_pending.erase(pending);
+        }
+        wl_callback_destroy(callback);
+    }
+
+    void sync(Workload workload)
+    {
+        static const wl_callback_listener callbackListener = {&LoadGenerator::syncDone};
+        wl_callback* callback = wl_display_sync(m_display);
+        wl_callback_add_listener(callback, &callbackListener, this);
+        m_pending[callback] = {workload, Clock::now()};
+        wl_display_flush(m_display);
+    }
+
+    void send(Workload workload, double time)
+    {
+        switch (workload)
+        {
+        case Workload::HeadPose:
+            sendHeadPose(time);
+            break;
+        case Workload::Recalibration:
+            recalibrate();
+            break;
+        case Workload::MirrorLevel:
+            sendMirrorLevel(time);
+            break;
+        case Workload::Count:
+            break;
+        }
+    }
+
+    /**
+     * Reference head position of a calibrated matrix, descending like the calibration of the vehicle.
+     */
+    float referenceHeadPosition(uint32_t matrix) const
+    {
+        const uint32_t count = std::max(m_settings.layout.matrixCount, 2u);
+        return HEAD_POSITION_RANGE * (0.5f - static_cast<float>(matrix) / static_cast<float>(count - 1));
+    }
+
+    void sendHeadPose(double time)
+    {
+        // The head sways across the whole calibrated range and a bit beyond, covering the clamped positions as well.
+        const float position = 0.6f * HEAD_POSITION_RANGE * static_cast<float>(std::sin(2.0 * std::numbers::pi * HEAD_SWAY_FREQUENCY * time));
+        std::array<float, 3> pose = {{position, position, position}};
+        wl_array             array = {sizeof(pose), sizeof(pose), pose.data()};
+        zmbition_warped_output_v1_set_head_position(m_warpedOutput, &array);
+        m_statistics[index(Workload::HeadPose)].requests++;
+        sync(Workload::HeadPose);
+    }
+
+    void recalibrate()
+    {
+        const Layout& layout = m_settings.layout;
+        for (uint32_t burst = 0; burst < m_settings.recalibrationBurst; burst++)
+        {
+            m_calibration++;
+            if (m_warpedOutput)
+            {
+                for (uint32_t matrix = 0; matrix < layout.matrixCount; matrix++)
+                {
+                    sendWarpingMatrix(matrix);
+                }
+            }
+            if (m_miniHud)
+            {
+                sendMiniHudMatrices();
+            }
+        }
+        sync(Workload::Recalibration);
+    }
+
+    void sendWarpingMatrix(uint32_t matrix)
+    {
+        const Layout& layout = m_settings.layout;
+        // Pixel positions of the calibration grid, shifted per matrix and per calibration so no update is a no-op.
+        std::vector<float> values(static_cast<size_t>(layout.matrixWidth) * layout.matrixHeight * 2);
+        const float        shift = static_cast<float>(matrix) + 0.25f * static_cast<float>(m_calibration % 4);
+        for (uint32_t y = 0; y < layout.matrixHeight; y++)
+        {
+            for (uint32_t x = 0; x < layout.matrixWidth; x++)
+            {
+                float* point = &values[2 * (x + static_cast<size_t>(y) * layout.matrixWidth)];
+                point[0]     = gridPosition(x, layout.matrixWidth, static_cast<float>(layout.displayWidth - 1)) + shift;
+                point[1]     = gridPosition(y, layout.matrixHeight, static_cast<float>(layout.displayHeight - 1)) + shift;
+            }
+        }
+
+        const float          reference    = referenceHeadPosition(matrix);
+        std::array<float, 3> headPosition = {{reference, reference, reference}};
+        wl_array             headArray    = {sizeof(headPosition), sizeof(headPosition), headPosition.data()};
+        wl_array             matrixArray  = {values.size() * sizeof(float), values.size() * sizeof(float), values.data()};
+        zmbition_warped_output_v1_set_warping_matrix(m_warpedOutput, matrix, &headArray, &matrixArray);
+        m_statistics[index(Workload::Recalibration)].requests++;
+    }
+
+    void sendMiniHudMatrices()
+    {
+        const Layout& layout  = m_settings.layout;
+        const float   marginX = static_cast<float>(layout.displayWidth - layout.appAreaWidth) / 2.0f;
+        const float   marginY = static_cast<float>(layout.displayHeight - layout.appAreaHeight) / 2.0f;
+
+        std::vector<MiniHudMeshModel::Parameters> levels(std::max(m_settings.mirrorLevels, 1u));
+        for (size_t level = 0; level < levels.size(); level++)
+        {
+            // Each mirror level moves the picture down a bit, as the real calibration does.
+            const float shift = 4.0f * static_cast<float>(level) + 0.25f * static_cast<float>(m_calibration % 4);
+            for (uint32_t y = 0; y < MiniHudMeshModel::PARAMETER_GRID_Y; y++)
+            {
+                for (uint32_t x = 0; x < MiniHudMeshModel::PARAMETER_GRID_X; x++)
+                {
+                    float* point = &levels[level][2 * (x + y * MiniHudMeshModel::PARAMETER_GRID_X)];
+                    point[0] = marginX + gridPosition(x, MiniHudMeshModel::PARAMETER_GRID_X, static_cast<float>(layout.appAreaWidth));
+                    point[1] = marginY + shift
+                               + gridPosition(y, MiniHudMeshModel::PARAMETER_GRID_Y, static_cast<float>(layout.appAreaHeight));
+                }
+            }
+        }
+
+        const int fd = memfd_create("arhud-loadgen", MFD_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+        const size_t size = levels.size() * sizeof(MiniHudMeshModel::Parameters);
+        if (write(fd, levels.data(), size) == static_cast<ssize_t>(size))
+        {
+            // libwayland duplicates the fd when marshalling the request.
+            mbition_mini_hud_warping_v1_setMatrices(m_miniHud, fd);
+            m_statistics[index(Workload::Recalibration)].requests++;
+        }
+        close(fd);
+    }
+
+    void sendMirrorLevel(double time)
+    {
+        // Triangle wave over the mirror level range. MBitionMiniHudWarping reads the raw wl_fixed_t value, the
+        // levels are sent the same way the mirror adjustment sends them.
+        const double phase = std::fmod(time / m_settings.mirrorSweepPeriod, 1.0);
+        const double sweep = phase < 0.5 ? 2.0 * phase : 2.0 - 2.0 * phase;
+        const auto   level = static_cast<wl_fixed_t>(std::lround(
+            MiniHudMeshModel::MIRROR_LEVEL_MIN + sweep * (MiniHudMeshModel::MIRROR_LEVEL_MAX - MiniHudMeshModel::MIRROR_LEVEL_MIN)));
+        mbition_mini_hud_warping_v1_setMirrorLevel(m_miniHud, level);
+        m_statistics[index(Workload::MirrorLevel)].requests++;
+        sync(Workload::MirrorLevel);
+    }
+
+    static float gridPosition(uint32_t index, uint32_t count, float extent)
+    {
+        return count > 1 ? extent * static_cast<float>(index) / static_cast<float>(count - 1) : 0.0f;
+    }
+
+    /**
+     * Flushes the requests and dispatches events until the deadline.
+     */
+    bool dispatch(Clock::time_point deadline, QTextStream& err)
+    {
+        while (wl_display_prepare_read(m_display) != 0)
+        {
+            wl_display_dispatch_pending(m_display);
+        }
+        if (wl_display_flush(m_display) < 0 && errno != EAGAIN)
+        {
+            wl_display_cancel_read(m_display);
+            err << "Connection to the compositor failed: " << std::strerror(errno) << Qt::endl;
+            return false;
+        }
+
+        const auto      wait    = std::max(deadline - Clock::now(), Clock::duration::zero());
+        const auto      seconds = std::chrono::duration_cast<std::chrono::seconds>(wait);
+        const timespec  timeout = {static_cast<time_t>(seconds.count()),
+                                   static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(wait - seconds).count())};
+        pollfd          pfd     = {wl_display_get_fd(m_display), POLLIN, 0};
+        if (ppoll(&pfd, 1, &timeout, nullptr) > 0 && (pfd.revents & POLLIN))
+        {
+            wl_display_read_events(m_display);
+        }
+        else
+        {
+            wl_display_cancel_read(m_display);
+        }
+
+        if (wl_display_dispatch_pending(m_display) < 0)
+        {
+            err << "Connection to the compositor failed: " << std::strerror(wl_display_get_error(m_display)) << Qt::endl;
+            return false;
+        }
+        return true;
+    }
+
+    struct PendingSync
+    {
+        Workload          workload;
+        Clock::time_point sent;
+    };
+
+    static constexpr float  HEAD_POSITION_RANGE = 0.2f;
+    static constexpr double HEAD_SWAY_FREQUENCY = 0.5;
+
+    wl_display*                                 m_display;
+    const Settings&                             m_settings;
+    wl_registry*                                m_registry            = nullptr;
+    wl_output*                                  m_output              = nullptr;
+    zmbition_warped_output_manager_v1*          m_warpedOutputManager = nullptr;
+    mbition_mini_hud_warping_manager_v1*        m_miniHudManager      = nullptr;
+    zmbition_warped_output_v1*                  m_warpedOutput        = nullptr;
+    mbition_mini_hud_warping_v1*                m_miniHud             = nullptr;
+    std::unordered_map<wl_callback*, PendingSync> m_pending;
+    std::array<Statistics, static_cast<size_t>(Workload::Count)> m_statistics;
+    uint32_t                                    m_calibration = 0;
+    double                                      m_elapsed     = 1.0;
+};
+
+Layout loadLayout(const QString& path, QTextStream& err)
+{
+    Layout layout;
+    QFile  file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        err << "Could not open " << path << ", using the default layout" << Qt::endl;
+        return layout;
+    }
+    const QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+
+    layout.displayWidth  = static_cast<uint32_t>(obj[u"DISPLAY_RESOLUTION_X"].toInt(static_cast<int>(layout.displayWidth)));
+    layout.displayHeight = static_cast<uint32_t>(obj[u"DISPLAY_RESOLUTION_Y"].toInt(static_cast<int>(layout.displayHeight)));
+    layout.appAreaWidth  = static_cast<uint32_t>(obj[u"CONTENT_RESOLUTION_X"].toInt(static_cast<int>(layout.displayWidth)));
+    layout.appAreaHeight = static_cast<uint32_t>(obj[u"CONTENT_RESOLUTION_Y"].toInt(static_cast<int>(layout.displayHeight)));
+    layout.matrixCount   = static_cast<uint32_t>(obj[u"WARPING_MATRIX_COUNT"].toInt(static_cast<int>(layout.matrixCount)));
+    layout.matrixWidth   = static_cast<uint32_t>(obj[u"WARPING_MATRIX_INPUT_RESOLUTION_X"].toInt(static_cast<int>(layout.matrixWidth)));
+    layout.matrixHeight  = static_cast<uint32_t>(obj[u"WARPING_MATRIX_INPUT_RESOLUTION_Y"].toInt(static_cast<int>(layout.matrixHeight)));
+    return layout;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("arhud-loadgen"));
+
+    const Settings defaults;
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Streams synthetic workloads through the warping protocols"));
+    parser.addHelpOption();
+    const QCommandLineOption configOption(QStringLiteral("config"),
+                                          QStringLiteral("Warping constants of the compositor"),
+                                          QStringLiteral("file"),
+                                          QStringLiteral("/opt/ui/kde/config/WarpingConstants.json"));
+    const QCommandLineOption durationOption(QStringLiteral("duration"),
+                                            QStringLiteral("Length of the run"),
+                                            QStringLiteral("seconds"),
+                                            QString::number(defaults.duration));
+    const QCommandLineOption headPoseRateOption(QStringLiteral("head-rate"),
+                                                QStringLiteral("Rate of set_head_position, 0 disables the head pose stream"),
+                                                QStringLiteral("Hz"),
+                                                QString::number(defaults.headPoseRate));
+    const QCommandLineOption recalibrationIntervalOption(QStringLiteral("recalibration-interval"),
+                                                         QStringLiteral("Time between recalibrations, 0 only calibrates once"),
+                                                         QStringLiteral("seconds"),
+                                                         QString::number(defaults.recalibrationInterval));
+    const QCommandLineOption recalibrationBurstOption(QStringLiteral("recalibration-burst"),
+                                                      QStringLiteral("Complete calibrations sent back to back per recalibration"),
+                                                      QStringLiteral("count"),
+                                                      QString::number(defaults.recalibrationBurst));
+    const QCommandLineOption matrixCountOption(QStringLiteral("matrix-count"),
+                                               QStringLiteral("Warping matrices per calibration, defaults to WARPING_MATRIX_COUNT"),
+                                               QStringLiteral("count"));
+    const QCommandLineOption matrixSizeOption(QStringLiteral("matrix-size"),
+                                              QStringLiteral("Warping matrix resolution, defaults to WARPING_MATRIX_INPUT_RESOLUTION"),
+                                              QStringLiteral("WxH"));
+    const QCommandLineOption noClassicHudOption(QStringLiteral("no-classic-hud"),
+                                                QStringLiteral("Does not bind zmbition_warped_output_manager_v1"));
+    const QCommandLineOption miniHudOption(QStringLiteral("mini-hud"),
+                                           QStringLiteral("Binds mbition_mini_hud_warping_manager_v1"));
+    const QCommandLineOption mirrorLevelsOption(QStringLiteral("mirror-levels"),
+                                                QStringLiteral("Calibrated mirror levels sent with setMatrices"),
+                                                QStringLiteral("count"),
+                                                QString::number(defaults.mirrorLevels));
+    const QCommandLineOption mirrorRateOption(QStringLiteral("mirror-rate"),
+                                              QStringLiteral("Rate of setMirrorLevel, 0 disables the mirror level sweep"),
+                                              QStringLiteral("Hz"),
+                                              QString::number(defaults.mirrorRate));
+    const QCommandLineOption mirrorSweepOption(QStringLiteral("mirror-sweep"),
+                                               QStringLiteral("Period of the mirror level sweep"),
+                                               QStringLiteral("seconds"),
+                                               QString::number(defaults.mirrorSweepPeriod));
+    parser.addOptions({configOption, durationOption, headPoseRateOption, recalibrationIntervalOption, recalibrationBurstOption,
+                       matrixCountOption, matrixSizeOption, noClassicHudOption, miniHudOption, mirrorLevelsOption,
+                       mirrorRateOption, mirrorSweepOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    Settings settings;
+    settings.layout = loadLayout(parser.value(configOption), err);
+    if (parser.isSet(matrixCountOption))
+    {
+        settings.layout.matrixCount = parser.value(matrixCountOption).toUInt();
+    }
+    if (parser.isSet(matrixSizeOption))
+    {
+        const QStringList size = parser.value(matrixSizeOption).split(QLatin1Char('x'));
+        if (size.size() != 2)
+        {
+            parser.showHelp(1);
+        }
+        settings.layout.matrixWidth  = size.constFirst().toUInt();
+        settings.layout.matrixHeight = size.constLast().toUInt();
+    }
+    settings.duration              = parser.value(durationOption).toDouble();
+    settings.headPoseRate          = parser.value(headPoseRateOption).toDouble();
+    settings.recalibrationInterval = parser.value(recalibrationIntervalOption).toDouble();
+    settings.recalibrationBurst    = std::max(parser.value(recalibrationBurstOption).toUInt(), 1u);
+    settings.classicHud            = !parser.isSet(noClassicHudOption);
+    settings.miniHud               = parser.isSet(miniHudOption);
+    settings.mirrorLevels          = std::max(parser.value(mirrorLevelsOption).toUInt(), 1u);
+    settings.mirrorRate            = parser.value(mirrorRateOption).toDouble();
+    settings.mirrorSweepPeriod     = std::max(parser.value(mirrorSweepOption).toDouble(), 0.001);
+
+    wl_display* display = wl_display_connect(nullptr);
+    if (!display)
+    {
+        err << "Could not connect to the Wayland display" << Qt::endl;
+        return 1;
+    }
+
+    bool success = false;
+    {
+        LoadGenerator generator(display, settings);
+        success = generator.connect(err) && generator.run(err);
+        if (success)
+        {
+            generator.report(out);
+        }
+    }
+    wl_display_disconnect(display);
+    return success ? 0 : 1;
+}
@@ -0,0 +1,401 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Replays a trace recorded with PROTOCOL_TRACE_FILE into the warping models without a compositor and reports how long
+// every request took to process. The GPU side is not replayed, see the effects for what they upload per request.
+
+#include "AdaptiveMeshBuilder.hxx"
+#include "MatrixTextureModel.hxx"
+#include "MiniHudMeshModel.hxx"
+#include "ProtocolTrace.hxx"
+#include "WarpingMatrixInterpolationModel.hxx"
+#include "WarpingUtils.hxx"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace
+{
+std::atomic<uint64_t> s_allocations{0};
+} // namespace
+
+// The models only allocate through operator new, counting it covers the request handling without hooking malloc.
+void* operator new(std::size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size > 0 ? size : 1))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t /*size*/) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+
+template<typename T>
+std::vector<T> readArray(const uint8_t* data, size_t size)
+{
+    std::vector<T> values(size / sizeof(T));
+    std::memcpy(values.data(), data, values.size() * sizeof(T));
+    return values;
+}
+
+/**
+ * Mirrors MBitionWarpedOutput and the mesh update of ClassicArHudEffect.
+ */
+class ClassicHudReplay
+{
+public:
+    ClassicHudReplay()
+        : m_headPositions(WARPING_MATRIX_COUNT)
+        , m_interpolationModel(WARPING_MATRIX_COUNT)
+        , m_textureModel(WARPING_MATRIX_COUNT, WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X, WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y)
+    {
+    }
+
+    bool headPosition(const std::vector<uint8_t>& payload)
+    {
+        WarpingMatrixInterpolationModel::Position position;
+        if (!readPosition(payload.data(), payload.size(), position))
+        {
+            return false;
+        }
+        m_interpolationModel.setEyePosition(position);
+
+        int32_t index;
+        float   factor;
+        m_interpolationModel.getInterpolationParameters(index, factor);
+        return true;
+    }
+
+    bool matrix(const std::vector<uint8_t>& payload)
+    {
+        uint32_t index;
+        uint32_t headPositionSize;
+        if (payload.size() < sizeof(index) + sizeof(headPositionSize))
+        {
+            return false;
+        }
+        std::memcpy(&index, payload.data(), sizeof(index));
+        std::memcpy(&headPositionSize, payload.data() + sizeof(index), sizeof(headPositionSize));
+        const size_t headPositionOffset = sizeof(index) + sizeof(headPositionSize);
+        if (index >= WARPING_MATRIX_COUNT || payload.size() < headPositionOffset + headPositionSize
+            || !readPosition(payload.data() + headPositionOffset, headPositionSize, m_headPositions[index]))
+        {
+            return false;
+        }
+
+        const size_t matrixOffset = headPositionOffset + headPositionSize;
+        const size_t expectedSize = sizeof(float) * WARPING_MATRIX_INPUT_RESOLUTION_X * WARPING_MATRIX_INPUT_RESOLUTION_Y * 2;
+        if (payload.size() - matrixOffset != expectedSize)
+        {
+            return false;
+        }
+        std::vector<float> values = readArray<float>(payload.data() + matrixOffset, expectedSize);
+        Matrix intermediate(WARPING_MATRIX_INPUT_RESOLUTION_X, WARPING_MATRIX_INPUT_RESOLUTION_Y, values.data());
+        auto extended = std::make_shared<Matrix>(WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X, WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y);
+        intermediate.getExtendedWarpingMatrix({float64_t(DISPLAY_RESOLUTION_X), float64_t(DISPLAY_RESOLUTION_Y)}, *extended);
+
+        m_textureModel.setMatrix(index, extended);
+        m_interpolationModel.setReferenceEyePosition(index, m_headPositions[index]);
+        m_initialized |= 1u << index;
+        if (m_initialized == (1u << WARPING_MATRIX_COUNT) - 1)
+        {
+            m_textureModel.getFloatTextureData(m_textureData);
+            buildMesh();
+        }
+        return true;
+    }
+
+private:
+    static bool readPosition(const uint8_t* data, size_t size, WarpingMatrixInterpolationModel::Position& position)
+    {
+        if (size != sizeof(float) * 3)
+        {
+            return false;
+        }
+        // Same as MBitionWarpedOutput::readHeadPosition(), head positions arrive at the tracker rate.
+        float values[3];
+        std::memcpy(values, data, sizeof(values));
+        position = {{values[0], values[1], values[2]}};
+        return true;
+    }
+
+    void buildMesh()
+    {
+        const bool bicubic = MESH_BICUBIC_INTERPOLATION;
+        AdaptiveMeshBuilder builder(WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X - 1, WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y - 1);
+        builder.setMaxErrorPixels(MESH_MAX_ERROR_PIXELS);
+        builder.setMinSubdivision(MESH_MIN_SUBDIVISION);
+        for (const MatrixTextureModel::MatrixPointer& pointer : m_textureModel.mMatrices)
+        {
+            const Matrix& matrix = *pointer;
+            builder.addSurface([&matrix, bicubic](float64_t x, float64_t y) {
+                const std::array<float64_t, 2> ssPos = bicubic ? matrix.sampleBicubic(x, y) : matrix.sampleBilinear(x, y);
+                return std::array<float64_t, 2>{{(ssPos[0] + 1.0) * 0.5 * DISPLAY_RESOLUTION_X,
+                                                 (ssPos[1] + 1.0) * 0.5 * DISPLAY_RESOLUTION_Y}};
+            });
+        }
+        MeshStatistics statistics;
+        builder.build(statistics);
+    }
+
+    std::vector<WarpingMatrixInterpolationModel::Position> m_headPositions;
+    WarpingMatrixInterpolationModel                        m_interpolationModel;
+    MatrixTextureModel                                     m_textureModel;
+    std::vector<float>                                     m_textureData;
+    uint32_t                                               m_initialized = 0;
+};
+
+/**
+ * Mirrors the mesh handling of DefaultHudEffect. Every mirror level is baked, the effect only bakes settled levels.
+ */
+class MiniHudReplay
+{
+public:
+    bool created(const std::vector<uint8_t>& payload)
+    {
+        if (payload.size() != sizeof(uint32_t) * 4)
+        {
+            return false;
+        }
+        const std::vector<uint32_t> sizes = readArray<uint32_t>(payload.data(), payload.size());
+        if (sizes[0] == 0 || sizes[1] == 0)
+        {
+            return false;
+        }
+        m_displayWidth  = static_cast<float>(sizes[0]);
+        m_displayHeight = static_cast<float>(sizes[1]);
+
+        // The effect samples an offscreen texture of the app area, the replay uses the whole display instead.
+        const float marginX = (m_displayWidth - static_cast<float>(sizes[2])) / 2.0f;
+        const float marginY = (m_displayHeight - static_cast<float>(sizes[3])) / 2.0f;
+        m_contentArea = {{marginX / m_displayWidth,
+                          marginY / m_displayHeight,
+                          (m_displayWidth - marginX) / m_displayWidth,
+                          (m_displayHeight - marginY) / m_displayHeight}};
+        return true;
+    }
+
+    bool matrices(const std::vector<uint8_t>& payload)
+    {
+        constexpr size_t dataSize = sizeof(MiniHudMeshModel::Parameters);
+        if (payload.size() < dataSize || payload.size() % dataSize != 0)
+        {
+            return false;
+        }
+        std::vector<MiniHudMeshModel::Parameters> levels(payload.size() / dataSize);
+        std::memcpy(levels.data(), payload.data(), payload.size());
+
+        m_model.setup(MiniHudMeshModel::layoutRegions(m_contentArea), levels, m_displayWidth, m_displayHeight,
+                      MESH_MAX_ERROR_PIXELS);
+        m_mesh.resize(m_model.vertexCount() * MiniHudMeshModel::FLOATS_PER_VERTEX);
+        return true;
+    }
+
+    bool mirrorLevel(const std::vector<uint8_t>& payload)
+    {
+        int32_t level;
+        if (payload.size() != sizeof(level))
+        {
+            return false;
+        }
+        std::memcpy(&level, payload.data(), sizeof(level));
+        if (m_model.isValid())
+        {
+            // Same conversion as MBitionMiniHudWarping.
+            m_model.evaluate(static_cast<float>(level), m_mesh.data());
+        }
+        return true;
+    }
+
+private:
+    MiniHudMeshModel     m_model;
+    std::vector<float>   m_mesh;
+    float                m_displayWidth  = 1.0f;
+    float                m_displayHeight = 1.0f;
+    std::array<float, 4> m_contentArea   = {{0.0f, 0.0f, 1.0f, 1.0f}};
+};
+
+struct RequestStatistics
+{
+    uint64_t                 count  = 0;
+    uint64_t                 failed = 0;
+    // Allocations after the first request of the type, which may still set up storage.
+    uint64_t                 allocations = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds max{0};
+};
+
+const char* requestName(ProtocolTraceType type)
+{
+    switch (type)
+    {
+    case ProtocolTraceType::WarpedOutputHeadPosition:
+        return "set_head_position";
+    case ProtocolTraceType::WarpedOutputMatrix:
+        return "set_warping_matrix";
+    case ProtocolTraceType::MiniHudCreated:
+        return "get_mini_hud";
+    case ProtocolTraceType::MiniHudMatrices:
+        return "setMatrices";
+    case ProtocolTraceType::MiniHudMirrorLevel:
+        return "setMirrorLevel";
+    case ProtocolTraceType::MiniHudWhitePoint:
+        return "setWhitePoint";
+    }
+    return "unknown";
+}
+
+/**
+ * Requests sent continuously while the HUD is in use. Their handling must not allocate, see --check-allocations.
+ */
+bool isSteadyState(ProtocolTraceType type)
+{
+    return type == ProtocolTraceType::WarpedOutputHeadPosition || type == ProtocolTraceType::MiniHudMirrorLevel;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("arhud-replay"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Replays a warping protocol trace into the warping models"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("trace"), QStringLiteral("Trace recorded with PROTOCOL_TRACE_FILE"));
+    const QCommandLineOption speedOption(QStringLiteral("speed"),
+                                         QStringLiteral("Replay speed relative to the recording, 0 replays as fast as possible"),
+                                         QStringLiteral("factor"),
+                                         QStringLiteral("1"));
+    const QCommandLineOption maxErrorOption(QStringLiteral("max-error"),
+                                            QStringLiteral("MESH_MAX_ERROR_PIXELS of the replayed effects"),
+                                            QStringLiteral("pixels"),
+                                            QString::number(MESH_MAX_ERROR_PIXELS));
+    const QCommandLineOption minSubdivisionOption(QStringLiteral("min-subdivision"),
+                                                  QStringLiteral("MESH_MIN_SUBDIVISION of the replayed effects"),
+                                                  QStringLiteral("levels"),
+                                                  QString::number(MESH_MIN_SUBDIVISION));
+    const QCommandLineOption bicubicOption(QStringLiteral("bicubic"), QStringLiteral("Sets MESH_BICUBIC_INTERPOLATION"));
+    const QCommandLineOption checkAllocationsOption(QStringLiteral("check-allocations"),
+                                                    QStringLiteral("Fails if head position or mirror level requests allocate"));
+    parser.addOptions({speedOption, maxErrorOption, minSubdivisionOption, bicubicOption, checkAllocationsOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    if (parser.positionalArguments().size() != 1)
+    {
+        parser.showHelp(1);
+    }
+
+    ProtocolTraceReader reader(parser.positionalArguments().constFirst().toStdString());
+    if (!reader.isOpen())
+    {
+        err << "Not a protocol trace: " << parser.positionalArguments().constFirst() << Qt::endl;
+        return 1;
+    }
+    reader.constants().apply();
+    MESH_MAX_ERROR_PIXELS      = parser.value(maxErrorOption).toFloat();
+    MESH_MIN_SUBDIVISION       = parser.value(minSubdivisionOption).toUInt();
+    MESH_BICUBIC_INTERPOLATION = parser.isSet(bicubicOption);
+    const double speed         = std::max(0.0, parser.value(speedOption).toDouble());
+
+    ClassicHudReplay classicHud;
+    MiniHudReplay    miniHud;
+    std::map<ProtocolTraceType, RequestStatistics> statistics;
+    std::chrono::nanoseconds maxLag{0};
+
+    const auto          start = std::chrono::steady_clock::now();
+    ProtocolTraceRecord record;
+    while (reader.next(record))
+    {
+        if (speed > 0.0)
+        {
+            const auto due = start + std::chrono::duration_cast<std::chrono::nanoseconds>(record.timestamp / speed);
+            std::this_thread::sleep_until(due);
+            maxLag = std::max(maxLag, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - due));
+        }
+
+        const uint64_t allocations = s_allocations.load(std::memory_order_relaxed);
+        const auto     begin       = std::chrono::steady_clock::now();
+        bool           valid       = true;
+        switch (record.type)
+        {
+        case ProtocolTraceType::WarpedOutputHeadPosition:
+            valid = classicHud.headPosition(record.payload);
+            break;
+        case ProtocolTraceType::WarpedOutputMatrix:
+            valid = classicHud.matrix(record.payload);
+            break;
+        case ProtocolTraceType::MiniHudCreated:
+            valid = miniHud.created(record.payload);
+            break;
+        case ProtocolTraceType::MiniHudMatrices:
+            valid = miniHud.matrices(record.payload);
+            break;
+        case ProtocolTraceType::MiniHudMirrorLevel:
+            valid = miniHud.mirrorLevel(record.payload);
+            break;
+        case ProtocolTraceType::MiniHudWhitePoint:
+            break;
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+        const uint64_t allocated = s_allocations.load(std::memory_order_relaxed) - allocations;
+
+        RequestStatistics& requests = statistics[record.type];
+        requests.allocations += requests.count > 0 ? allocated : 0;
+        requests.count++;
+        requests.failed += valid ? 0 : 1;
+        requests.total += elapsed;
+        requests.max = std::max(requests.max, elapsed);
+    }
+
+    out << "request                count  invalid    mean us     max us   allocs" << Qt::endl;
+    bool steadyStateAllocates = false;
+    for (const auto& [type, requests] : statistics)
+    {
+        const double mean = std::chrono::duration<double, std::micro>(requests.total).count() / static_cast<double>(requests.count);
+        const double max  = std::chrono::duration<double, std::micro>(requests.max).count();
+        out << QString::fromLatin1(requestName(type)).leftJustified(18) << QString::number(requests.count).rightJustified(9)
+            << QString::number(requests.failed).rightJustified(9) << QString::number(mean, 'f', 1).rightJustified(11)
+            << QString::number(max, 'f', 1).rightJustified(11) << QString::number(requests.allocations).rightJustified(9)
+            << Qt::endl;
+        steadyStateAllocates |= isSteadyState(type) && requests.allocations > 0;
+    }
+    if (speed > 0.0)
+    {
+        out << "largest delay behind the recording: "
+            << QString::number(std::chrono::duration<double, std::milli>(maxLag).count(), 'f', 2) << " ms" << Qt::endl;
+    }
+    if (parser.isSet(checkAllocationsOption) && steadyStateAllocates)
+    {
+        err << "Head position or mirror level requests allocated memory" << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "ProtocolTrace.hxx"
+
+#include "WarpingConstants.hxx"
+
+#include <array>
+#include <memory>
+
+namespace
+{
+  constexpr std::array<char, 8> TRACE_MAGIC   = {{'A', 'R', 'H', 'U', 'D', 'T', 'R', 'C'}};
+  constexpr uint32_t            TRACE_VERSION = 1;
+
+  /**
+   * @brief Refuse records larger than this instead of allocating whatever a corrupt size field claims.
+   */
+  constexpr uint32_t MAX_PAYLOAD_SIZE = 64u * 1024u * 1024u;
+
+  template<typename T>
+  void writeValue(std::ofstream& stream, const T& value)
+  {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  template<typename T>
+  bool readValue(std::ifstream& stream, T& value)
+  {
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  }
+}
+
+namespace Warping
+{
+
+  ProtocolTraceConstants ProtocolTraceConstants::current()
+  {
+    return {DISPLAY_RESOLUTION_X,
+            DISPLAY_RESOLUTION_Y,
+            WARPING_MATRIX_INPUT_RESOLUTION_X,
+            WARPING_MATRIX_INPUT_RESOLUTION_Y,
+            WARPING_MATRIX_COUNT,
+            CONTENT_RESOLUTION_X,
+            CONTENT_RESOLUTION_Y,
+            WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X,
+            WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y};
+  }
+
+  void ProtocolTraceConstants::apply() const
+  {
+    DISPLAY_RESOLUTION_X                     = displayResolutionX;
+    DISPLAY_RESOLUTION_Y                     = displayResolutionY;
+    WARPING_MATRIX_INPUT_RESOLUTION_X        = matrixInputResolutionX;
+    WARPING_MATRIX_INPUT_RESOLUTION_Y        = matrixInputResolutionY;
+    WARPING_MATRIX_COUNT                     = matrixCount;
+    CONTENT_RESOLUTION_X                     = contentResolutionX;
+    CONTENT_RESOLUTION_Y                     = contentResolutionY;
+    WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X = matrixExtrapolatedResolutionX;
+    WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y = matrixExtrapolatedResolutionY;
+  }
+
+  ProtocolTraceWriter::ProtocolTraceWriter(const std::string& path)
+    : mStream(path, std::ios::binary | std::ios::trunc)
+    , mStart(std::chrono::steady_clock::now())
+  {
+    if (!mStream)
+    {
+      return;
+    }
+    mStream.write(TRACE_MAGIC.data(), TRACE_MAGIC.size());
+    writeValue(mStream, TRACE_VERSION);
+    writeValue(mStream, ProtocolTraceConstants::current());
+    mStream.flush();
+  }
+
+  ProtocolTraceWriter* ProtocolTraceWriter::instance()
+  {
+    static const std::unique_ptr<ProtocolTraceWriter> writer = []() -> std::unique_ptr<ProtocolTraceWriter> {
+      if (PROTOCOL_TRACE_FILE.empty())
+      {
+        return nullptr;
+      }
+      auto opened = std::make_unique<ProtocolTraceWriter>(PROTOCOL_TRACE_FILE);
+      return opened->isOpen() ? std::move(opened) : nullptr;
+    }();
+    return writer.get();
+  }
+
+  bool ProtocolTraceWriter::isOpen() const
+  {
+    return mStream.is_open() && mStream.good();
+  }
+
+  void ProtocolTraceWriter::record(ProtocolTraceType type, std::initializer_list<Chunk> payload)
+  {
+    if (!isOpen())
+    {
+      return;
+    }
+
+    uint32_t size = 0;
+    for (const Chunk& chunk : payload)
+    {
+      size += static_cast<uint32_t>(chunk.second);
+    }
+    const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mStart);
+
+    writeValue(mStream, static_cast<uint64_t>(timestamp.count()));
+    writeValue(mStream, static_cast<uint32_t>(type));
+    writeValue(mStream, size);
+    for (const Chunk& chunk : payload)
+    {
+      mStream.write(static_cast<const char*>(chunk.first), static_cast<std::streamsize>(chunk.second));
+    }
+    mStream.flush();
+  }
+
+  ProtocolTraceReader::ProtocolTraceReader(const std::string& path)
+    : mStream(path, std::ios::binary)
+  {
+    std::array<char, TRACE_MAGIC.size()> magic{};
+    uint32_t                             version = 0;
+    mOpen = mStream.read(magic.data(), magic.size()) && magic == TRACE_MAGIC && readValue(mStream, version)
+         && version == TRACE_VERSION && readValue(mStream, mConstants);
+  }
+
+  bool ProtocolTraceReader::isOpen() const
+  {
+    return mOpen;
+  }
+
+  const ProtocolTraceConstants& ProtocolTraceReader::constants() const
+  {
+    return mConstants;
+  }
+
+  bool ProtocolTraceReader::next(ProtocolTraceRecord& record)
+  {
+    uint64_t timestamp = 0;
+    uint32_t type      = 0;
+    uint32_t size      = 0;
+    if (!mOpen || !readValue(mStream, timestamp) || !readValue(mStream, type) || !readValue(mStream, size)
+        || size > MAX_PAYLOAD_SIZE)
+    {
+      return false;
+    }
+
+    record.timestamp = std::chrono::nanoseconds(static_cast<int64_t>(timestamp));
+    record.type      = static_cast<ProtocolTraceType>(type);
+    record.payload.resize(size);
+    return static_cast<bool>(mStream.read(reinterpret_cast<char*>(record.payload.data()), size));
+  }
+
+}
@@ -0,0 +1,143 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Warping
+{
+
+  /**
+   * @brief Requests of the warping protocols stored in a trace. The payload holds the request arguments as received.
+   */
+  enum class ProtocolTraceType : uint32_t
+  {
+    /**
+     * @brief zmbition_warped_output_v1.set_head_position: the position array.
+     */
+    WarpedOutputHeadPosition = 1,
+    /**
+     * @brief zmbition_warped_output_v1.set_warping_matrix: uint32 index, uint32 size of the head position array,
+     * the head position array and the matrix array.
+     */
+    WarpedOutputMatrix = 2,
+    /**
+     * @brief mbition_mini_hud_warping_manager_v1.get_mini_hud: uint32 display width and height, app area width and
+     * height.
+     */
+    MiniHudCreated = 3,
+    /**
+     * @brief mbition_mini_hud_warping_v1.setMatrices: the contents of the file descriptor.
+     */
+    MiniHudMatrices = 4,
+    /**
+     * @brief mbition_mini_hud_warping_v1.setMirrorLevel: int32 wl_fixed_t mirror level.
+     */
+    MiniHudMirrorLevel = 5,
+    /**
+     * @brief mbition_mini_hud_warping_v1.setWhitePoint: uint32 red, green, blue and divisor.
+     */
+    MiniHudWhitePoint = 6,
+  };
+
+  /**
+   * @brief The warping constants a trace was recorded with, the payloads are only meaningful with them.
+   */
+  struct ProtocolTraceConstants
+  {
+    uint32_t displayResolutionX;
+    uint32_t displayResolutionY;
+    uint32_t matrixInputResolutionX;
+    uint32_t matrixInputResolutionY;
+    uint32_t matrixCount;
+    uint32_t contentResolutionX;
+    uint32_t contentResolutionY;
+    uint32_t matrixExtrapolatedResolutionX;
+    uint32_t matrixExtrapolatedResolutionY;
+
+    static ProtocolTraceConstants current();
+
+    /**
+     * @brief Overwrites the warping constants with the ones of the trace.
+     */
+    void apply() const;
+  };
+
+  struct ProtocolTraceRecord
+  {
+    /**
+     * @brief Time since the start of the recording.
+     */
+    std::chrono::nanoseconds timestamp;
+    ProtocolTraceType        type;
+    std::vector<uint8_t>     payload;
+  };
+
+  /**
+   * @brief Records the warping protocol requests into a binary trace.
+   *
+   * The trace starts with the magic "ARHUDTRC", a uint32 version and the ProtocolTraceConstants. Every record is a
+   * uint64 timestamp in nanoseconds, the uint32 type, the uint32 payload size and the payload, all in host byte order.
+   */
+  class ProtocolTraceWriter final
+  {
+  public:
+    /**
+     * @brief A piece of a payload, the pieces of a record are stored back to back.
+     */
+    using Chunk = std::pair<const void*, size_t>;
+
+    explicit ProtocolTraceWriter(const std::string& path);
+
+    /**
+     * @brief Returns the writer of PROTOCOL_TRACE_FILE, nullptr if recording is disabled or the file can't be opened.
+     */
+    static ProtocolTraceWriter* instance();
+
+    bool isOpen() const;
+
+    /**
+     * @brief Appends a record and flushes it, so that a trace survives a crash of the compositor.
+     */
+    void record(ProtocolTraceType type, std::initializer_list<Chunk> payload);
+
+  private:
+    std::ofstream                         mStream;
+    std::chrono::steady_clock::time_point mStart;
+  };
+
+  /**
+   * @brief Reads a trace written by the ProtocolTraceWriter.
+   */
+  class ProtocolTraceReader final
+  {
+  public:
+    explicit ProtocolTraceReader(const std::string& path);
+
+    /**
+     * @brief Returns whether the file is a trace of a supported version.
+     */
+    bool isOpen() const;
+
+    const ProtocolTraceConstants& constants() const;
+
+    /**
+     * @brief Reads the next record, false at the end of the trace or on a truncated record.
+     */
+    bool next(ProtocolTraceRecord& record);
+
+  private:
+    std::ifstream          mStream;
+    ProtocolTraceConstants mConstants{};
+    bool                   mOpen = false;
+  };
+
+}
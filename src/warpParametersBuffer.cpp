@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "warpParametersBuffer.h"
+
+#include "kwinarhud_debug.h"
+
+namespace KWin
+{
+
+WarpParametersBuffer::WarpParametersBuffer()
+{
+    glGenBuffers(1, &m_buffer);
+    if (m_buffer == 0)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Failed to create the warp parameters buffer";
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Parameters), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+WarpParametersBuffer::~WarpParametersBuffer()
+{
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void WarpParametersBuffer::update(const std::array<float, 4>& uvFunc, uint32_t matrixResolutionX, uint32_t matrixResolutionY)
+{
+    Parameters parameters{};
+    parameters.uvFunc = uvFunc;
+    parameters.matrixResolution = {{static_cast<float>(matrixResolutionX), static_cast<float>(matrixResolutionY)}};
+
+    if (m_uploaded && parameters == m_parameters)
+    {
+        return;
+    }
+    m_parameters = parameters;
+    m_uploaded = true;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Parameters), &m_parameters);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void WarpParametersBuffer::bind()
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_buffer);
+}
+
+} // namespace KWin
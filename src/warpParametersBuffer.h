@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <epoxy/gl.h>
+
+#include <array>
+#include <cstdint>
+
+namespace KWin
+{
+
+/**
+ * Uniform buffer with the WarpParameters block of warping_arhud_classic_core.vert, the values of the warped output
+ * that only change with the offscreen target or a recalibration.
+ *
+ * The block is compared against the uploaded one every frame and only uploaded when it differs, so the steady state
+ * costs a single bind. The pose lives in the HeadPoseBuffer.
+ */
+class WarpParametersBuffer
+{
+public:
+    static constexpr GLuint BINDING = 1;
+
+    WarpParametersBuffer();
+    ~WarpParametersBuffer();
+
+    WarpParametersBuffer(const WarpParametersBuffer&) = delete;
+    WarpParametersBuffer& operator=(const WarpParametersBuffer&) = delete;
+
+    bool isValid() const { return m_buffer != 0; }
+
+    /**
+     * Uploads the parameters if they differ from the last upload.
+     */
+    void update(const std::array<float, 4>& uvFunc, uint32_t matrixResolutionX, uint32_t matrixResolutionY);
+
+    /**
+     * Binds the buffer to BINDING.
+     */
+    void bind();
+
+private:
+    // std140 layout of the block.
+    struct Parameters
+    {
+        std::array<float, 4> uvFunc;
+        std::array<float, 2> matrixResolution;
+        std::array<float, 2> padding;
+
+        bool operator==(const Parameters&) const = default;
+    };
+    static_assert(sizeof(Parameters) == 32, "std140 size of the WarpParameters block");
+
+    GLuint m_buffer = 0;
+    Parameters m_parameters{};
+    bool m_uploaded = false;
+};
+
+} // namespace KWin
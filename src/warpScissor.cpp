@@ -0,0 +1,73 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "warpScissor.h"
+
+#include <cmath>
+
+namespace KWin
+{
+
+static void setScissor(const QRect& rect)
+{
+    glScissor(rect.x(), rect.y(), rect.width(), rect.height());
+}
+
+void WarpScissor::begin(const QRectF& ndcBounds)
+{
+    std::array<GLint, 4> viewport{};
+    glGetIntegerv(GL_VIEWPORT, viewport.data());
+    const QRect viewportRect(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (viewportRect != m_viewport)
+    {
+        m_viewport = viewportRect;
+        m_history.fill(viewportRect);
+    }
+
+    // Window coordinates, rounded outwards and grown by a pixel for the rasterization rules at the edges.
+    QRect bounds = viewportRect;
+    if (!ndcBounds.isEmpty())
+    {
+        const double scaleX = viewportRect.width() / 2.0;
+        const double scaleY = viewportRect.height() / 2.0;
+        // QRectF::top() is the smallest y, the bottom edge in window coordinates.
+        const int left = static_cast<int>(std::floor(viewportRect.x() + (ndcBounds.left() + 1.0) * scaleX)) - 1;
+        const int bottom = static_cast<int>(std::floor(viewportRect.y() + (ndcBounds.top() + 1.0) * scaleY)) - 1;
+        const int right = static_cast<int>(std::ceil(viewportRect.x() + (ndcBounds.right() + 1.0) * scaleX)) + 1;
+        const int top = static_cast<int>(std::ceil(viewportRect.y() + (ndcBounds.bottom() + 1.0) * scaleY)) + 1;
+        bounds = QRect(left, bottom, right - left, top - bottom).intersected(viewportRect);
+    }
+
+    QRect clearRect = bounds;
+    for (const QRect& previous : m_history)
+    {
+        clearRect = clearRect.united(previous);
+    }
+    m_history[m_frame++ % s_historyFrames] = bounds;
+
+    m_previousEnabled = glIsEnabled(GL_SCISSOR_TEST);
+    glGetIntegerv(GL_SCISSOR_BOX, m_previousBox.data());
+
+    glEnable(GL_SCISSOR_TEST);
+    setScissor(clearRect);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    setScissor(bounds);
+}
+
+void WarpScissor::invalidate()
+{
+    // The viewport is only known in begin(), an empty one makes it fill the history with the next viewport.
+    m_viewport = QRect();
+}
+
+void WarpScissor::end()
+{
+    glScissor(m_previousBox[0], m_previousBox[1], m_previousBox[2], m_previousBox[3]);
+    if (!m_previousEnabled)
+    {
+        glDisable(GL_SCISSOR_TEST);
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,56 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QRect>
+#include <QRectF>
+
+#include <epoxy/gl.h>
+
+#include <array>
+
+namespace KWin
+{
+
+/**
+ * Restricts the clear and the draw of a warp pass to the screen-space bounds of the warped mesh, leaving the black
+ * rest of the HUD output untouched.
+ *
+ * The clear also covers the bounds of the last frames, the swapchain hands out its buffers in turn and a buffer still
+ * holds the mesh of the frame it was last drawn in. While the viewport is new, or after frames that were painted
+ * without the warp, the whole target is cleared.
+ */
+class WarpScissor
+{
+public:
+    /**
+     * Clears the bounds of this and the last frames and scissors the following draws to the bounds.
+     *
+     * @param[in] ndcBounds Bounds of the mesh in normalized device coordinates of the current viewport, an empty
+     * rectangle stands for the whole viewport.
+     */
+    void begin(const QRectF& ndcBounds);
+
+    /**
+     * Restores the scissor state from before begin().
+     */
+    void end();
+
+    /**
+     * Marks the whole viewport as drawn, for frames that painted the scene unwarped instead of calling begin().
+     */
+    void invalidate();
+
+private:
+    static constexpr size_t s_historyFrames = 4;
+
+    std::array<QRect, s_historyFrames> m_history{};
+    size_t m_frame = 0;
+    QRect m_viewport;
+
+    GLboolean m_previousEnabled = GL_FALSE;
+    std::array<GLint, 4> m_previousBox{};
+};
+
+} // namespace KWin
@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "MiniHudMeshModel.hxx"
+#include "WarpingMatrixInterpolationModel.hxx"
+#include "WarpingUtils.hxx"
+
+#include <QRect>
+#include <QVector3D>
+
+#include <epoxy/gl.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace KWin
+{
+
+/**
+ * Latest value of a stream, handed from one writer to one reader.
+ *
+ * Triple buffered: the writer fills its own slot and swaps it with the published one, the reader swaps the published
+ * slot with its own when a new value arrived. Neither side waits for the other or allocates, and the value the reader
+ * holds stays valid until its next read(), however often the writer publishes meanwhile.
+ */
+template<typename T>
+class LatestValue
+{
+public:
+    /**
+     * Publishes a value, writer side only.
+     */
+    void publish(T value)
+    {
+        m_slots[m_writeSlot] = std::move(value);
+        m_writeSlot = m_published.exchange(m_writeSlot | FRESH, std::memory_order_acq_rel) & SLOT_MASK;
+    }
+
+    /**
+     * Returns the latest published value, reader side only. A default constructed T until the first publish().
+     */
+    const T& read()
+    {
+        if (m_published.load(std::memory_order_relaxed) & FRESH)
+        {
+            m_readSlot = m_published.exchange(m_readSlot, std::memory_order_acq_rel) & SLOT_MASK;
+        }
+        return m_slots[m_readSlot];
+    }
+
+private:
+    static constexpr uint32_t SLOT_MASK = 0x3;
+    static constexpr uint32_t FRESH = 0x4;
+
+    std::array<T, 3> m_slots{};
+    std::atomic<uint32_t> m_published{1};
+    uint32_t m_writeSlot = 0;
+    uint32_t m_readSlot = 2;
+};
+
+/**
+ * Calibration of the classic HUD, published by MBitionWarpedOutput once every matrix was received and uploaded.
+ * A published calibration is never modified, a recalibration publishes a new one. That includes its matrix texture:
+ * MBitionWarpedOutput writes a recalibration into the other one of two textures.
+ */
+struct WarpCalibration
+{
+    // Extrapolated matrices in screen space, the mesh is fitted to them. Shared with the writer and the other
+    // calibrations, a recalibration only replaces the matrices it changes.
+    std::vector<std::shared_ptr<const Warping::Matrix>> matrices;
+    std::vector<WarpingMatrixInterpolationModel::Position> referencePositions;
+
+    // Matrix texture with all matrices stacked vertically, owned by MBitionWarpedOutput. Not written again before the
+    // calibration after the next one is published.
+    GLuint texture = 0;
+    // GL_RG32F with one texel per node or GL_RGBA8 with two encoded texels per node
+    GLenum textureFormat = GL_RGBA8;
+    // Incremented with every published calibration.
+    uint32_t generation = 0;
+
+    // Configuration the calibration was built for, see WarpingConstants.json.
+    uint32_t matrixCount = 0;
+    uint32_t resolutionX = 0;
+    uint32_t resolutionY = 0;
+};
+
+/**
+ * Head pose of the classic HUD as interpolation parameters between the matrices of the latest calibration.
+ */
+struct WarpPose
+{
+    WarpingMatrixInterpolationModel::Position headPosition{};
+    int32_t matrixIndex = 0;
+    float matrixFactor = 0.0f;
+    // Generation of the calibration the parameters were interpolated for.
+    uint32_t generation = 0;
+};
+
+/**
+ * State a classic HUD frame is painted with. The pose is published together with the calibration it was interpolated
+ * for, so a frame never pairs the matrices of one calibration with a pose between those of another.
+ */
+struct WarpState
+{
+    std::shared_ptr<const WarpCalibration> calibration;
+    WarpPose pose;
+};
+
+/**
+ * Mirror adjustment of the mini HUD as set by the client.
+ */
+struct MirrorState
+{
+    float mirrorLevel = 5.0f;
+    QVector3D whitePoint{1.0f, 1.0f, 1.0f};
+};
+
+/**
+ * Calibration of the mini HUD, built by DefaultHudEffect from the level parameters, the HUD size and the mesh tolerance.
+ * A published calibration is never modified, any of them changing publishes a new one.
+ */
+struct MiniHudCalibration
+{
+    MiniHudMeshModel meshModel;
+    // Packed per-region parameters, coarse regions first, see ShaderRegion::pack().
+    std::vector<float> regionParameters;
+    uint32_t regionParameterTexels = 0;
+
+    // Part of the display rendered into the offscreen targets in device pixels.
+    QRect sourceRect;
+    // Display size in logical pixels, the space of the level parameters.
+    float windowWidth = 0.0f;
+    float windowHeight = 0.0f;
+    float meshMaxError = 0.0f;
+    // Incremented with every published calibration.
+    uint32_t generation = 0;
+};
+
+/**
+ * State a mini HUD frame is painted with.
+ */
+struct MiniHudState
+{
+    std::shared_ptr<const MiniHudCalibration> calibration;
+    MirrorState mirror;
+};
+
+} // namespace KWin
@@ -0,0 +1,282 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "warpingDBusInterface.h"
+#include "classicArHud.h"
+#include "defaultHud.h"
+#include "offscreenTarget.h"
+#include "warpingStatistics.h"
+#include "WarpingConstants.hxx"
+
+#include <QDBusConnection>
+
+#include "kwinarhud_debug.h"
+
+namespace KWin
+{
+
+static const QString s_objectPath = QStringLiteral("/ArHud");
+
+/**
+ * Any client on the session bus could change the warp otherwise, the tuning is meant for the bench only.
+ */
+static bool isTuningEnabled(const char* property)
+{
+    if (!Warping::DBUS_TUNING)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Ignoring D-Bus write of" << property << "- DBUS_TUNING is off";
+    }
+    return Warping::DBUS_TUNING;
+}
+
+static QVariantMap statisticsMap(const WarpingStatistics& statistics,
+                                 const FrameBudgetGovernor& governor,
+                                 const QString& warpPath,
+                                 std::chrono::microseconds prewarmDuration)
+{
+    QVariantMap map;
+    map[QStringLiteral("framesRendered")] = qulonglong(statistics.framesRendered());
+    map[QStringLiteral("framesSkipped")] = qulonglong(statistics.framesSkipped());
+    map[QStringLiteral("framesReprojected")] = qulonglong(statistics.framesReprojected());
+    map[QStringLiteral("posesReceived")] = qulonglong(statistics.posesReceived());
+    map[QStringLiteral("matricesDeduplicated")] = qulonglong(statistics.matricesDeduplicated());
+    map[QStringLiteral("poseRateHz")] = statistics.poseRate();
+    map[QStringLiteral("offscreenBytes")] = qulonglong(statistics.offscreenBytes());
+    map[QStringLiteral("warpPath")] = warpPath;
+    map[QStringLiteral("tier")] = FrameBudgetGovernor::tierName(governor.tier());
+    map[QStringLiteral("governorCpuUs")] = governor.cpuTime();
+    map[QStringLiteral("governorGpuUs")] = governor.gpuTime();
+    map[QStringLiteral("prewarmUs")] = qlonglong(prewarmDuration.count());
+
+    for (uint32_t index = 0; index < static_cast<uint32_t>(WarpingStatistics::Timing::Count); index++)
+    {
+        const auto timing = static_cast<WarpingStatistics::Timing>(index);
+        const WarpingStatistics::Percentiles percentiles = statistics.percentiles(timing);
+        const QString name = QString::fromLatin1(WarpingStatistics::timingName(timing));
+        map[name + QStringLiteral("Samples")] = uint(percentiles.samples);
+        map[name + QStringLiteral("P50Us")] = percentiles.p50;
+        map[name + QStringLiteral("P95Us")] = percentiles.p95;
+        map[name + QStringLiteral("P99Us")] = percentiles.p99;
+        map[name + QStringLiteral("MaxUs")] = percentiles.max;
+    }
+    return map;
+}
+
+WarpingDBusInterface::WarpingDBusInterface(ClassicArHudEffect* classicHud, DefaultHudEffect* miniHud, QObject* parent)
+    : QObject(parent)
+    , m_classicHud(classicHud)
+    , m_miniHud(miniHud)
+{
+    if (!QDBusConnection::sessionBus().registerObject(s_objectPath, this,
+                                                      QDBusConnection::ExportAllProperties | QDBusConnection::ExportAllSlots))
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Failed to register the D-Bus interface at" << s_objectPath;
+    }
+    else if (Warping::DBUS_TUNING)
+    {
+        qCInfo(KWINARHUD_DEBUG) << "Warping tuning on the session bus enabled at" << s_objectPath;
+    }
+}
+
+WarpingDBusInterface::~WarpingDBusInterface()
+{
+    QDBusConnection::sessionBus().unregisterObject(s_objectPath);
+}
+
+QString WarpingDBusInterface::warpMode() const
+{
+    // Same precedence as WarpingEffect::paintScreen().
+    if (m_classicHud->isActive())
+    {
+        return QStringLiteral("classic");
+    }
+    if (m_miniHud->isActive())
+    {
+        return QStringLiteral("mini");
+    }
+    return QStringLiteral("inactive");
+}
+
+QVariantMap WarpingDBusInterface::statistics() const
+{
+    QVariantMap map;
+    if (m_classicHud->isActive())
+    {
+        WarpingStatistics& statistics = m_classicHud->statistics();
+        map = statisticsMap(statistics, m_classicHud->governor(), ClassicArHudEffect::warpPathName(statistics.warpPath()),
+                            m_classicHud->prewarmDuration());
+    }
+    else if (m_miniHud->isActive())
+    {
+        WarpingStatistics& statistics = m_miniHud->statistics();
+        map = statisticsMap(statistics, m_miniHud->governor(), DefaultHudEffect::warpPathName(statistics.warpPath()),
+                            m_miniHud->prewarmDuration());
+    }
+    map[QStringLiteral("mode")] = warpMode();
+    return map;
+}
+
+void WarpingDBusInterface::resetStatistics()
+{
+    m_classicHud->statistics().reset();
+    m_miniHud->statistics().reset();
+}
+
+double WarpingDBusInterface::meshMaxErrorPixels() const
+{
+    return Warping::MESH_MAX_ERROR_PIXELS;
+}
+
+void WarpingDBusInterface::setMeshMaxErrorPixels(double pixels)
+{
+    if (!isTuningEnabled("meshMaxErrorPixels"))
+    {
+        return;
+    }
+    if (!Warping::isValidMeshMaxErrorPixels(pixels))
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Ignoring mesh error tolerance" << pixels << "px - it has to be 0 to"
+                                   << Warping::MESH_MAX_ERROR_PIXELS_LIMIT;
+        return;
+    }
+    qCInfo(KWINARHUD_DEBUG) << "MESH_MAX_ERROR_PIXELS set over D-Bus:" << pixels;
+    // Both meshes compare the tolerance they were built with against the configured one in every frame.
+    Warping::MESH_MAX_ERROR_PIXELS = static_cast<float>(pixels);
+}
+
+uint WarpingDBusInterface::meshMinSubdivision() const
+{
+    return Warping::MESH_MIN_SUBDIVISION;
+}
+
+void WarpingDBusInterface::setMeshMinSubdivision(uint subdivision)
+{
+    if (!isTuningEnabled("meshMinSubdivision"))
+    {
+        return;
+    }
+    if (!Warping::isValidMeshMinSubdivision(subdivision))
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Ignoring mesh subdivision" << subdivision << "- it has to be 0 to"
+                                   << Warping::MESH_MIN_SUBDIVISION_LIMIT;
+        return;
+    }
+    qCInfo(KWINARHUD_DEBUG) << "MESH_MIN_SUBDIVISION set over D-Bus:" << subdivision;
+    Warping::MESH_MIN_SUBDIVISION = subdivision;
+}
+
+bool WarpingDBusInterface::bicubicInterpolation() const
+{
+    return Warping::MESH_BICUBIC_INTERPOLATION;
+}
+
+void WarpingDBusInterface::setBicubicInterpolation(bool bicubic)
+{
+    if (!isTuningEnabled("bicubicInterpolation"))
+    {
+        return;
+    }
+    qCInfo(KWINARHUD_DEBUG) << "MESH_BICUBIC_INTERPOLATION set over D-Bus:" << bicubic;
+    Warping::MESH_BICUBIC_INTERPOLATION = bicubic;
+}
+
+QString WarpingDBusInterface::classicOffscreenFormat() const
+{
+    return offscreenFormatName(m_classicHud->offscreenFormat());
+}
+
+void WarpingDBusInterface::setClassicOffscreenFormat(const QString& format)
+{
+    if (!isTuningEnabled("classicOffscreenFormat"))
+    {
+        return;
+    }
+    const OffscreenFormat parsed = offscreenFormatFromName(format);
+    qCInfo(KWINARHUD_DEBUG) << "CLASSIC_HUD_OFFSCREEN_FORMAT set over D-Bus:" << offscreenFormatName(parsed);
+    Warping::CLASSIC_HUD_OFFSCREEN_FORMAT = offscreenFormatName(parsed).toStdString();
+    m_classicHud->setOffscreenFormat(parsed);
+}
+
+QString WarpingDBusInterface::miniHudOffscreenFormat() const
+{
+    return offscreenFormatName(m_miniHud->offscreenFormat());
+}
+
+void WarpingDBusInterface::setMiniHudOffscreenFormat(const QString& format)
+{
+    if (!isTuningEnabled("miniHudOffscreenFormat"))
+    {
+        return;
+    }
+    const OffscreenFormat parsed = offscreenFormatFromName(format);
+    qCInfo(KWINARHUD_DEBUG) << "MINI_HUD_OFFSCREEN_FORMAT set over D-Bus:" << offscreenFormatName(parsed);
+    Warping::MINI_HUD_OFFSCREEN_FORMAT = offscreenFormatName(parsed).toStdString();
+    m_miniHud->setOffscreenFormat(parsed);
+}
+
+bool WarpingDBusInterface::miniHudInstanced() const
+{
+    return m_miniHud->forceInstanced();
+}
+
+void WarpingDBusInterface::setMiniHudInstanced(bool instanced)
+{
+    if (!isTuningEnabled("miniHudInstanced"))
+    {
+        return;
+    }
+    qCInfo(KWINARHUD_DEBUG) << "Mini HUD mesh evaluation set over D-Bus:" << (instanced ? "instanced" : "baked when settled");
+    m_miniHud->setForceInstanced(instanced);
+}
+
+bool WarpingDBusInterface::performanceOverlay() const
+{
+    return Warping::PERFORMANCE_OVERLAY;
+}
+
+void WarpingDBusInterface::setPerformanceOverlay(bool enabled)
+{
+    if (!isTuningEnabled("performanceOverlay"))
+    {
+        return;
+    }
+    qCInfo(KWINARHUD_DEBUG) << "PERFORMANCE_OVERLAY set over D-Bus:" << enabled;
+    Warping::PERFORMANCE_OVERLAY = enabled;
+}
+
+bool WarpingDBusInterface::warpOnlyReprojection() const
+{
+    return Warping::WARP_ONLY_REPROJECTION;
+}
+
+void WarpingDBusInterface::setWarpOnlyReprojection(bool enabled)
+{
+    if (!isTuningEnabled("warpOnlyReprojection"))
+    {
+        return;
+    }
+    qCInfo(KWINARHUD_DEBUG) << "WARP_ONLY_REPROJECTION set over D-Bus:" << enabled;
+    Warping::WARP_ONLY_REPROJECTION = enabled;
+}
+
+uint WarpingDBusInterface::offscreenRingDepth() const
+{
+    return Warping::OFFSCREEN_RING_DEPTH;
+}
+
+void WarpingDBusInterface::setOffscreenRingDepth(uint depth)
+{
+    if (!isTuningEnabled("offscreenRingDepth"))
+    {
+        return;
+    }
+    if (depth < 1 || depth > OffscreenRing::MAX_DEPTH)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "Ignoring offscreen ring depth" << depth << "- it has to be 1 to" << OffscreenRing::MAX_DEPTH;
+        return;
+    }
+    qCInfo(KWINARHUD_DEBUG) << "OFFSCREEN_RING_DEPTH set over D-Bus:" << depth;
+    Warping::OFFSCREEN_RING_DEPTH = depth;
+}
+
+} // namespace KWin
@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+namespace KWin
+{
+
+class ClassicArHudEffect;
+class DefaultHudEffect;
+
+/**
+ * Telemetry and tuning of the warping effects on the session bus, at /ArHud of the compositor.
+ *
+ * The statistics describe the HUD that is currently warped. The setters change the configuration of
+ * WarpingConstants.json for the running compositor only, the effects pick the new values up in their next frame.
+ * The properties are only writable with DBUS_TUNING set in WarpingConstants.json, values out of range are ignored.
+ *
+ * @code
+ * qdbus org.kde.KWin /ArHud io.mbition.kwinarhud.Warping.statistics
+ * qdbus org.kde.KWin /ArHud org.freedesktop.DBus.Properties.Set io.mbition.kwinarhud.Warping meshMaxErrorPixels 1.0
+ * @endcode
+ */
+class WarpingDBusInterface : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "io.mbition.kwinarhud.Warping")
+
+    Q_PROPERTY(QString warpMode READ warpMode)
+    Q_PROPERTY(double meshMaxErrorPixels READ meshMaxErrorPixels WRITE setMeshMaxErrorPixels)
+    Q_PROPERTY(uint meshMinSubdivision READ meshMinSubdivision WRITE setMeshMinSubdivision)
+    Q_PROPERTY(bool bicubicInterpolation READ bicubicInterpolation WRITE setBicubicInterpolation)
+    Q_PROPERTY(QString classicOffscreenFormat READ classicOffscreenFormat WRITE setClassicOffscreenFormat)
+    Q_PROPERTY(QString miniHudOffscreenFormat READ miniHudOffscreenFormat WRITE setMiniHudOffscreenFormat)
+    Q_PROPERTY(bool miniHudInstanced READ miniHudInstanced WRITE setMiniHudInstanced)
+    Q_PROPERTY(bool performanceOverlay READ performanceOverlay WRITE setPerformanceOverlay)
+    Q_PROPERTY(bool warpOnlyReprojection READ warpOnlyReprojection WRITE setWarpOnlyReprojection)
+    Q_PROPERTY(uint offscreenRingDepth READ offscreenRingDepth WRITE setOffscreenRingDepth)
+
+public:
+    WarpingDBusInterface(ClassicArHudEffect* classicHud, DefaultHudEffect* miniHud, QObject* parent = nullptr);
+    ~WarpingDBusInterface() override;
+
+    /**
+     * "classic", "mini" or "inactive" if no HUD client is bound.
+     */
+    QString warpMode() const;
+
+    double meshMaxErrorPixels() const;
+    void setMeshMaxErrorPixels(double pixels);
+    uint meshMinSubdivision() const;
+    void setMeshMinSubdivision(uint subdivision);
+    bool bicubicInterpolation() const;
+    void setBicubicInterpolation(bool bicubic);
+    QString classicOffscreenFormat() const;
+    void setClassicOffscreenFormat(const QString& format);
+    QString miniHudOffscreenFormat() const;
+    void setMiniHudOffscreenFormat(const QString& format);
+    bool miniHudInstanced() const;
+    void setMiniHudInstanced(bool instanced);
+    bool performanceOverlay() const;
+    void setPerformanceOverlay(bool enabled);
+    bool warpOnlyReprojection() const;
+    void setWarpOnlyReprojection(bool enabled);
+    uint offscreenRingDepth() const;
+    void setOffscreenRingDepth(uint depth);
+
+public Q_SLOTS:
+    /**
+     * Counters, timing percentiles in µs over the last frames and the state of the warped HUD, empty but for the mode
+     * while inactive.
+     */
+    QVariantMap statistics() const;
+
+    /**
+     * Clears the counters and timing histories of both HUDs.
+     */
+    void resetStatistics();
+
+private:
+    ClassicArHudEffect* m_classicHud;
+    DefaultHudEffect* m_miniHud;
+};
+
+} // namespace KWin
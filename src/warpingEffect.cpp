@@ -4,8 +4,10 @@
 #include "warpingEffect.h"
 #include "defaultHud.h"
 #include "classicArHud.h"
+#include "warpingDBusInterface.h"
 #include "kwinarhud_debug.h"
 
+#include <core/output.h>
 #include <effect/effecthandler.h>
 
 namespace KWin {
@@ -13,6 +15,7 @@ namespace KWin {
 WarpingEffect::WarpingEffect()
     : m_arHudEffect(std::make_unique<ClassicArHudEffect>())
     , m_miniArHudEffect(std::make_unique<DefaultHudEffect>())
+    , m_dbusInterface(std::make_unique<WarpingDBusInterface>(m_arHudEffect.get(), m_miniArHudEffect.get()))
 {}
 
 WarpingEffect::~WarpingEffect() = default;
@@ -36,4 +39,22 @@ bool WarpingEffect::supported() {
     return effects->compositingType() == OpenGLCompositing && effects->waylandDisplay();
 }
 
+Output* WarpingEffect::findHudScreen(uint32_t width, uint32_t height) {
+    int screenIndex = 0;
+    for (Output* screen : effects->screens()) {
+        if (!screen) {
+            qCWarning(KWINARHUD_DEBUG) << "findHudScreen: screen" << screenIndex << "is nullptr";
+        } else {
+            qCInfo(KWINARHUD_DEBUG) << "Screen" << screenIndex << ":" << screen->manufacturer() << "," << screen->model()
+                                    << "," << screen->name() << "," << screen->geometry();
+            if (static_cast<uint32_t>(screen->geometry().width()) == width
+                && static_cast<uint32_t>(screen->geometry().height()) == height) {
+                return screen;
+            }
+        }
+        screenIndex++;
+    }
+    return nullptr;
+}
+
 }
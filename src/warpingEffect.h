@@ -5,6 +5,7 @@
 
 #include <effect/effect.h>
 
+#include <cstdint>
 #include <memory>
 
 namespace KWin
@@ -14,6 +15,7 @@ class EffectBase;
 
 class ClassicArHudEffect;
 class DefaultHudEffect;
+class WarpingDBusInterface;
 
 class WarpingEffect : public Effect
 {
@@ -26,9 +28,16 @@ public:
     bool isActive() const override;
     static bool supported();
 
+    /**
+     * Returns the first screen of the given size in logical pixels, which identifies the HUD, or nullptr. Every screen
+     * is logged along the way.
+     */
+    static Output* findHudScreen(uint32_t width, uint32_t height);
+
 private:
     const std::unique_ptr<ClassicArHudEffect> m_arHudEffect;
     const std::unique_ptr<DefaultHudEffect> m_miniArHudEffect;
+    const std::unique_ptr<WarpingDBusInterface> m_dbusInterface;
 };
 
 }
@@ -0,0 +1,207 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "warpingStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace KWin
+{
+
+static int64_t steadyNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void WarpingStatistics::record(Timing timing, std::chrono::steady_clock::duration duration)
+{
+    record(timing, std::chrono::duration<double, std::micro>(duration).count());
+}
+
+void WarpingStatistics::record(Timing timing, double microseconds)
+{
+    History& history = m_histories[static_cast<size_t>(timing)];
+    const uint32_t count = history.count.load(std::memory_order_relaxed);
+    history.samples[count % HISTORY_SIZE].store(static_cast<float>(microseconds), std::memory_order_relaxed);
+    history.count.store(count + 1, std::memory_order_release);
+}
+
+void WarpingStatistics::frameRendered(std::chrono::steady_clock::duration frameCpu, std::chrono::steady_clock::duration warpCpu)
+{
+    record(Timing::FrameCpu, frameCpu);
+    record(Timing::WarpCpu, warpCpu);
+    m_framesRendered.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WarpingStatistics::frameSkipped()
+{
+    m_framesSkipped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WarpingStatistics::frameReprojected()
+{
+    m_framesReprojected.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WarpingStatistics::poseReceived()
+{
+    const int64_t now = steadyNow();
+    const int64_t last = m_lastPose.exchange(now, std::memory_order_relaxed);
+    m_posesReceived.fetch_add(1, std::memory_order_relaxed);
+    if (last == 0)
+    {
+        return;
+    }
+
+    const double interval = static_cast<double>(now - last) / 1000.0;
+    const double smoothed = m_poseInterval.load(std::memory_order_relaxed);
+    m_poseInterval.store(smoothed == 0.0 ? interval : smoothed + s_poseSmoothing * (interval - smoothed),
+                         std::memory_order_relaxed);
+}
+
+void WarpingStatistics::matrixDeduplicated()
+{
+    m_matricesDeduplicated.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WarpingStatistics::setOffscreenBytes(uint64_t bytes)
+{
+    m_offscreenBytes.store(bytes, std::memory_order_relaxed);
+}
+
+void WarpingStatistics::setWarpPath(uint32_t path)
+{
+    m_warpPath.store(path, std::memory_order_relaxed);
+}
+
+uint64_t WarpingStatistics::framesRendered() const
+{
+    return m_framesRendered.load(std::memory_order_relaxed);
+}
+
+uint64_t WarpingStatistics::framesSkipped() const
+{
+    return m_framesSkipped.load(std::memory_order_relaxed);
+}
+
+uint64_t WarpingStatistics::framesReprojected() const
+{
+    return m_framesReprojected.load(std::memory_order_relaxed);
+}
+
+uint64_t WarpingStatistics::posesReceived() const
+{
+    return m_posesReceived.load(std::memory_order_relaxed);
+}
+
+uint64_t WarpingStatistics::matricesDeduplicated() const
+{
+    return m_matricesDeduplicated.load(std::memory_order_relaxed);
+}
+
+double WarpingStatistics::poseRate() const
+{
+    const int64_t last = m_lastPose.load(std::memory_order_relaxed);
+    const double interval = m_poseInterval.load(std::memory_order_relaxed);
+    if (last == 0 || interval <= 0.0)
+    {
+        return 0.0;
+    }
+    // The smoothed interval only changes with the next pose, the time since the last one bounds the rate once they stop.
+    const double sinceLast = static_cast<double>(steadyNow() - last) / 1000.0;
+    return 1.0e6 / std::max(interval, sinceLast);
+}
+
+double WarpingStatistics::poseAge() const
+{
+    const int64_t last = m_lastPose.load(std::memory_order_relaxed);
+    return last == 0 ? -1.0 : static_cast<double>(steadyNow() - last) / 1000.0;
+}
+
+uint64_t WarpingStatistics::offscreenBytes() const
+{
+    return m_offscreenBytes.load(std::memory_order_relaxed);
+}
+
+uint32_t WarpingStatistics::warpPath() const
+{
+    return m_warpPath.load(std::memory_order_relaxed);
+}
+
+WarpingStatistics::Percentiles WarpingStatistics::percentiles(Timing timing) const
+{
+    const History& history = m_histories[static_cast<size_t>(timing)];
+    const uint32_t count = std::min(history.count.load(std::memory_order_acquire), HISTORY_SIZE);
+
+    std::array<float, HISTORY_SIZE> samples;
+    for (uint32_t index = 0; index < count; index++)
+    {
+        samples[index] = history.samples[index].load(std::memory_order_relaxed);
+    }
+    std::sort(samples.begin(), samples.begin() + count);
+
+    Percentiles result;
+    result.samples = count;
+    if (count == 0)
+    {
+        return result;
+    }
+    // Nearest rank, so every percentile is a sample that was actually measured.
+    const auto rank = [&samples, count](double percentile) {
+        const auto index = static_cast<uint32_t>(std::ceil(percentile * count));
+        return static_cast<double>(samples[std::clamp(index, 1u, count) - 1]);
+    };
+    result.p50 = rank(0.50);
+    result.p95 = rank(0.95);
+    result.p99 = rank(0.99);
+    result.max = static_cast<double>(samples[count - 1]);
+    return result;
+}
+
+uint32_t WarpingStatistics::latest(Timing timing, std::span<float> samples) const
+{
+    const History& history = m_histories[static_cast<size_t>(timing)];
+    const uint32_t count = history.count.load(std::memory_order_acquire);
+    const uint32_t copied = std::min({ count, HISTORY_SIZE, static_cast<uint32_t>(samples.size()) });
+    for (uint32_t index = 0; index < copied; index++)
+    {
+        samples[index] = history.samples[(count - copied + index) % HISTORY_SIZE].load(std::memory_order_relaxed);
+    }
+    return copied;
+}
+
+const char* WarpingStatistics::timingName(Timing timing)
+{
+    switch (timing)
+    {
+    case Timing::FrameCpu:
+        return "cpuFrame";
+    case Timing::WarpCpu:
+        return "cpuWarp";
+    case Timing::FrameGpu:
+        return "gpuFrame";
+    case Timing::MatrixUpload:
+        return "matrixUpload";
+    case Timing::Count:
+        break;
+    }
+    return "";
+}
+
+void WarpingStatistics::reset()
+{
+    for (History& history : m_histories)
+    {
+        history.count.store(0, std::memory_order_relaxed);
+    }
+    m_framesRendered.store(0, std::memory_order_relaxed);
+    m_framesSkipped.store(0, std::memory_order_relaxed);
+    m_framesReprojected.store(0, std::memory_order_relaxed);
+    m_posesReceived.store(0, std::memory_order_relaxed);
+    m_matricesDeduplicated.store(0, std::memory_order_relaxed);
+    m_lastPose.store(0, std::memory_order_relaxed);
+    m_poseInterval.store(0.0, std::memory_order_relaxed);
+}
+
+} // namespace KWin
@@ -0,0 +1,116 @@
+// SPDX-FileCopyrightText: Copyright (c) 2025 MBition GmbH.
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+
+namespace KWin
+{
+
+/**
+ * Counters and timing histories of one HUD output, read by the D-Bus interface.
+ *
+ * Every value has a single writer, the paint pass or a request handler, that records without locking or allocating.
+ * Readers copy the values and may see a history mixing two frames, which is harmless for statistics.
+ */
+class WarpingStatistics
+{
+public:
+    enum class Timing : uint32_t
+    {
+        FrameCpu, // whole paint pass, scene included
+        WarpCpu, // warp draw after the scene pass
+        FrameGpu, // whole paint pass, measured by the frame budget governor
+        MatrixUpload, // handling a matrix request, reading and uploading the matrices
+        Count,
+    };
+
+    struct Percentiles
+    {
+        double p50 = 0.0; // µs
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        uint32_t samples = 0;
+    };
+
+    /**
+     * Number of the latest samples of every timing the percentiles are taken from.
+     */
+    static constexpr uint32_t HISTORY_SIZE = 256;
+
+    void record(Timing timing, std::chrono::steady_clock::duration duration);
+    void record(Timing timing, double microseconds);
+
+    void frameRendered(std::chrono::steady_clock::duration frameCpu, std::chrono::steady_clock::duration warpCpu);
+    void frameSkipped();
+    /**
+     * Counts a frame that only warped the previous offscreen target again, after frameRendered().
+     */
+    void frameReprojected();
+    void poseReceived();
+    /**
+     * Counts a matrix request that resent the matrix already applied and was dropped.
+     */
+    void matrixDeduplicated();
+    void setOffscreenBytes(uint64_t bytes);
+    void setWarpPath(uint32_t path);
+
+    uint64_t framesRendered() const;
+    uint64_t framesSkipped() const;
+    uint64_t framesReprojected() const;
+    uint64_t posesReceived() const;
+    uint64_t matricesDeduplicated() const;
+    /**
+     * Smoothed rate of the received poses in Hz, falling towards zero once they stop.
+     */
+    double poseRate() const;
+    /**
+     * Time since the last pose in µs, negative before the first one.
+     */
+    double poseAge() const;
+    uint64_t offscreenBytes() const;
+    /**
+     * Warp path of the last rendered frame, its meaning is up to the effect.
+     */
+    uint32_t warpPath() const;
+
+    Percentiles percentiles(Timing timing) const;
+    /**
+     * Copies the latest samples of a timing in µs, oldest first, and returns how many there were.
+     */
+    uint32_t latest(Timing timing, std::span<float> samples) const;
+    static const char* timingName(Timing timing);
+
+    /**
+     * Clears the counters and histories, the offscreen memory and the warp path describe the current state and stay.
+     */
+    void reset();
+
+private:
+    struct History
+    {
+        std::array<std::atomic<float>, HISTORY_SIZE> samples{};
+        std::atomic<uint32_t> count{ 0 };
+    };
+
+    static constexpr double s_poseSmoothing = 0.1;
+
+    std::array<History, static_cast<size_t>(Timing::Count)> m_histories;
+    std::atomic<uint64_t> m_framesRendered{ 0 };
+    std::atomic<uint64_t> m_framesSkipped{ 0 };
+    std::atomic<uint64_t> m_framesReprojected{ 0 };
+    std::atomic<uint64_t> m_posesReceived{ 0 };
+    std::atomic<uint64_t> m_matricesDeduplicated{ 0 };
+    std::atomic<int64_t> m_lastPose{ 0 }; // steady clock, ns
+    std::atomic<double> m_poseInterval{ 0.0 }; // µs, exponentially smoothed
+    std::atomic<uint64_t> m_offscreenBytes{ 0 };
+    std::atomic<uint32_t> m_warpPath{ 0 };
+};
+
+} // namespace KWin
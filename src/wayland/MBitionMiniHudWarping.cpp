@@ -4,6 +4,11 @@
 #include "MBitionMiniHudWarping.h"
 
 #include "defaultHud.h"
+#include "ProtocolTrace.hxx"
+
+#include <unistd.h>
+
+#include <vector>
 
 MBitionMiniHudWarping::MBitionMiniHudWarping(KWin::DefaultHudEffect* hud_effect)
     : QtWaylandServer::mbition_mini_hud_warping_v1()
@@ -29,6 +34,17 @@ void MBitionMiniHudWarping::mbition_mini_hud_warping_v1_setMatrices([[maybe_unus
         return;
     }
 
+    if (auto trace = Warping::ProtocolTraceWriter::instance()) {
+        // setMatrices() consumes the fd, record its contents up front.
+        const off_t size = lseek(fd, 0, SEEK_END);
+        std::vector<char> contents(size > 0 ? static_cast<size_t>(size) : 0);
+        if (!contents.empty() && pread(fd, contents.data(), contents.size(), 0) != size) {
+            qCWarning(KWINARHUD_DEBUG) << "Recording setMatrices failed - could not read the fd";
+            contents.clear();
+        }
+        trace->record(Warping::ProtocolTraceType::MiniHudMatrices, { { contents.data(), contents.size() } });
+    }
+
     m_effect->setMatrices(fd);
 }
 
@@ -39,6 +55,10 @@ void MBitionMiniHudWarping::mbition_mini_hud_warping_v1_setMirrorLevel([[maybe_u
         return;
     }
 
+    if (auto trace = Warping::ProtocolTraceWriter::instance()) {
+        trace->record(Warping::ProtocolTraceType::MiniHudMirrorLevel, { { &mirrorLevel, sizeof(mirrorLevel) } });
+    }
+
     m_effect->setMirrorLevel(static_cast<float>(mirrorLevel));
 }
 
@@ -49,6 +69,11 @@ void MBitionMiniHudWarping::mbition_mini_hud_warping_v1_setWhitePoint([[maybe_un
         return;
     }
 
+    if (auto trace = Warping::ProtocolTraceWriter::instance()) {
+        const uint32_t whitePoint[] = { red, green, blue, divisor };
+        trace->record(Warping::ProtocolTraceType::MiniHudWhitePoint, { { whitePoint, sizeof(whitePoint) } });
+    }
+
     float div = static_cast<float>(divisor);
     m_effect->setWhitePoint(red / div, green / div, blue / div);
 }
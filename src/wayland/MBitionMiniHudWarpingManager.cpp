@@ -5,6 +5,8 @@
 
 #include "MBitionMiniHudWarping.h"
 #include "defaultHud.h"
+#include "warpingEffect.h"
+#include "ProtocolTrace.hxx"
 
 #include <wayland/display.h>
 #include <wayland/output.h>
@@ -33,30 +35,17 @@ void MBitionMiniHudWarpingManager::mbition_mini_hud_warping_manager_v1_get_mini_
     }
 
     qCInfo(KWINARHUD_DEBUG) << "get_mini_hud args:" << displayWidth << displayHeight << appAreaWidth << appAreaHeight;
+    if (auto trace = Warping::ProtocolTraceWriter::instance())
+    {
+        const uint32_t sizes[] = { displayWidth, displayHeight, appAreaWidth, appAreaHeight };
+        trace->record(Warping::ProtocolTraceType::MiniHudCreated, { { sizes, sizeof(sizes) } });
+    }
     m_effect->setHudSize(displayWidth, displayHeight, appAreaWidth, appAreaHeight);
 
-    int screen_index = 0;
-    const auto& screens = KWin::effects->screens();
-    for (auto screen : screens)
+    m_screen = KWin::WarpingEffect::findHudScreen(displayWidth, displayHeight);
+    if (m_screen)
     {
-        if (!screen)
-        {
-            qCWarning(KWINARHUD_DEBUG) << "Printing screen data failed - Screen" << screen_index << "is nullptr!";
-            continue;
-        }
-
-        qCInfo(KWINARHUD_DEBUG) << "Screen [" << screen_index << "]: " << screen->manufacturer() << "," << screen->model()
-                              << "," << screen->name() << "," << screen->geometry();
-
-        if (static_cast<unsigned int>(screen->geometry().width()) == displayWidth &&
-            static_cast<unsigned int>(screen->geometry().height()) == displayHeight)
-        {
-            qCInfo(KWINARHUD_DEBUG) << "Found screen" << screen_index << "with size:" << displayWidth << "x" << displayHeight;
-            m_screen = screen;
-            break;
-        }
-
-        screen_index++;
+        qCInfo(KWINARHUD_DEBUG) << "Found screen" << m_screen->name() << "with size:" << displayWidth << "x" << displayHeight;
     }
 
     if (m_screen != nullptr)
@@ -6,45 +6,56 @@
 #include "MatrixTextureModel.hxx"
 #include "WarpingMatrixInterpolationModel.hxx"
 #include "WarpingUtils.hxx"
+#include "ProtocolTrace.hxx"
 #include "classicArHud.h"
+#include "offscreenTarget.h"
 
-MBitionWarpedOutput::MBitionWarpedOutput()
+#include <QHashFunctions>
+
+#include <algorithm>
+#include <chrono>
+
+MBitionWarpedOutput::MBitionWarpedOutput(KWin::ClassicArHudEffect* effect)
     : QtWaylandServer::zmbition_warped_output_v1(),
-    m_texture(0),
+    m_effect(effect),
+    m_staleRegions(WARPING_MATRIX_COUNT, std::array<uint32_t, 4>{}),
     m_initialized(0),
     m_calibratedHeadPositions(WARPING_MATRIX_COUNT),
+    m_payloadHashes(WARPING_MATRIX_COUNT),
     m_matrixInterpolationModel(WARPING_MATRIX_COUNT),
     m_matrixTextureModel(WARPING_MATRIX_COUNT,
                          WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X,
                          WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y)
 {
-    glGenTextures(1, &m_texture);
-    if (m_texture == GL_NONE)
+    glGenTextures(2, m_textures.data());
+    if (m_textures[0] == GL_NONE || m_textures[1] == GL_NONE)
     {
         qCWarning(KWINARHUD_DEBUG) << "failed to create texture";
     }
-
-    m_calibratedMatrices.reserve(WARPING_MATRIX_COUNT);
-    for (uint32_t i = 0; i < WARPING_MATRIX_COUNT; i++)
-    {
-        m_calibratedMatrices.emplace_back(WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X,
-                                        WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y);
-    }
 }
 
 void MBitionWarpedOutput::zmbition_warped_output_v1_set_head_position(Resource* /*resource*/, wl_array* position)
 {
-    qCDebug(KWINARHUD_DEBUG) << "setting new head position";
-
+    // Sent at the tracker rate, the handler neither logs nor allocates.
     if (!position)
     {
         qCWarning(KWINARHUD_DEBUG) << "setting new head position failed. invalid position";
         return;
     }
 
-    WarpingMatrixInterpolationModel::Position headPos;
-    readHeadPosition(headPos, position);
-    m_matrixInterpolationModel.setEyePosition(headPos);
+    if (auto trace = Warping::ProtocolTraceWriter::instance())
+    {
+        trace->record(Warping::ProtocolTraceType::WarpedOutputHeadPosition, {{position->data, position->size}});
+    }
+
+    readHeadPosition(m_headPosition, position);
+    m_matrixInterpolationModel.setEyePosition(m_headPosition);
+    const KWin::WarpPose pose = publishPose();
+
+    if (m_effect)
+    {
+        m_effect->headPositionChanged(pose);
+    }
 }
 
 void MBitionWarpedOutput::zmbition_warped_output_v1_set_warping_matrix(Resource* resource,
@@ -52,7 +63,6 @@ void MBitionWarpedOutput::zmbition_warped_output_v1_set_warping_matrix(Resource*
                                                                        wl_array* head_position,
                                                                        wl_array* matrix)
 {
-    qCInfo(KWINARHUD_DEBUG) << "setting new matrices";
     if (!resource)
     {
         qCWarning(KWINARHUD_DEBUG) << "setting new matrices failed. invalid resource";
@@ -69,6 +79,16 @@ void MBitionWarpedOutput::zmbition_warped_output_v1_set_warping_matrix(Resource*
         return;
     }
 
+    if (auto trace = Warping::ProtocolTraceWriter::instance())
+    {
+        const uint32_t headPositionSize = static_cast<uint32_t>(head_position->size);
+        trace->record(Warping::ProtocolTraceType::WarpedOutputMatrix,
+                      {{&index, sizeof(index)},
+                       {&headPositionSize, sizeof(headPositionSize)},
+                       {head_position->data, head_position->size},
+                       {matrix->data, matrix->size}});
+    }
+
     if (index >= Warping::WARPING_MATRIX_COUNT)
     {
         wl_resource_post_error(resource->handle,
@@ -77,10 +97,52 @@ void MBitionWarpedOutput::zmbition_warped_output_v1_set_warping_matrix(Resource*
         return;
     }
 
-    readHeadPosition(m_calibratedHeadPositions[index], head_position);
-    readWarpingMatrix(m_calibratedMatrices[index], matrix);
+    const auto start = std::chrono::steady_clock::now();
+
+    MatrixTextureModel::MatrixPointer extended = readWarpingMatrix(matrix);
+    if (!extended)
+    {
+        return;
+    }
+    WarpingMatrixInterpolationModel::Position headPosition = m_calibratedHeadPositions[index];
+    readHeadPosition(headPosition, head_position);
+
+    // The diagnosis client resends unchanged matrices periodically, those are traced above but neither uploaded nor
+    // published.
+    const size_t payloadHash = qHashBits(matrix->data, matrix->size, qHashBits(head_position->data, head_position->size));
+    if (isResent(index, payloadHash, headPosition, *extended))
+    {
+        qCDebug(KWINARHUD_DEBUG) << "matrix" << index << "unchanged, skipped";
+        if (m_effect)
+        {
+            m_effect->statistics().matrixDeduplicated();
+        }
+        return;
+    }
+    qCInfo(KWINARHUD_DEBUG) << "setting new matrices";
+    m_payloadHashes[index] = payloadHash;
+    m_calibratedHeadPositions[index] = headPosition;
+
+    setMatrix(index, std::move(extended));
+
+    if (m_effect)
+    {
+        m_effect->statistics().record(KWin::WarpingStatistics::Timing::MatrixUpload, std::chrono::steady_clock::now() - start);
+    }
+}
 
-    setMatrix(index);
+bool MBitionWarpedOutput::isResent(uint32_t index,
+                                   size_t hash,
+                                   const WarpingMatrixInterpolationModel::Position& headPosition,
+                                   const Warping::Matrix& matrix) const
+{
+    if (!(m_initialized & (1 << index)) || m_payloadHashes[index] != hash || headPosition != m_calibratedHeadPositions[index])
+    {
+        return false;
+    }
+    // Equal hashes are not proof, the matrix the model holds decides.
+    const std::array<uint32_t, 4> region = matrix.differingRegion(m_matrixTextureModel.getMatrix(index));
+    return region[0] >= region[2] || region[1] >= region[3];
 }
 
 void MBitionWarpedOutput::zmbition_warped_output_v1_destroy(Resource* resource)
@@ -93,44 +155,194 @@ void MBitionWarpedOutput::zmbition_warped_output_v1_destroy(Resource* resource)
     wl_resource_destroy(resource->handle);
 }
 
-void MBitionWarpedOutput::setMatrix(uint32_t index)
+/**
+ * @brief Returns the bounding box of two node regions {x0, y0, x1, y1}, either of which may be empty.
+ */
+static std::array<uint32_t, 4> unitedRegion(const std::array<uint32_t, 4>& a, const std::array<uint32_t, 4>& b)
 {
-    // TODO: m_calibratedMatrices can probably go
-    if (index >= static_cast<int>(sizeof(m_calibratedMatrices)))
+    const auto isEmpty = [](const std::array<uint32_t, 4>& region) {
+        return region[0] >= region[2] || region[1] >= region[3];
+    };
+    if (isEmpty(a))
     {
-        qCWarning(KWINARHUD_DEBUG) << "setMatrix failed. index out of bounds: " << index
-                                   << ", count of calibrated matrices: " << sizeof(m_calibratedMatrices);
-        return;
+        return b;
     }
-    if (index >= static_cast<int>(sizeof(m_calibratedHeadPositions)))
+    if (isEmpty(b))
     {
-        qCWarning(KWINARHUD_DEBUG) << "setMatrix failed. index out of bounds: " << index
-                                   << ", count of calibrated head positions: " << sizeof(m_calibratedHeadPositions);
-        return;
+        return a;
     }
-    m_matrixTextureModel.setMatrix(index, m_calibratedMatrices[index]);
+    return {{std::min(a[0], b[0]), std::min(a[1], b[1]), std::max(a[2], b[2]), std::max(a[3], b[3])}};
+}
+
+void MBitionWarpedOutput::setMatrix(uint32_t index, MatrixTextureModel::MatrixPointer matrix)
+{
+    // Recalibrations usually move part of the grid, only the nodes that changed get uploaded. Extrapolating the whole
+    // matrix again is cheap compared to the upload and keeps the border nodes exact.
+    const std::array<uint32_t, 4> region = matrix->differingRegion(m_matrixTextureModel.getMatrix(index));
+
+    // The model holds the only CPU copy of the matrix, shared with the published calibrations.
+    m_matrixTextureModel.setMatrix(index, std::move(matrix));
     m_matrixInterpolationModel.setReferenceEyePosition(index, m_calibratedHeadPositions[index]);
 
     m_initialized |= 1 << index;
-    if (isInitialized())
+    if (!isInitialized())
     {
-        glBindTexture(GL_TEXTURE_2D, m_texture);
+        return;
+    }
+
+    if (m_textureFormat == GL_NONE)
+    {
+        allocateTexture();
+    }
+    else
+    {
+        // The texture of the latest calibration is left alone, the other one catches up on the nodes it missed.
+        const uint32_t texture = 1 - m_texture;
+        for (uint32_t stale = 0; stale < WARPING_MATRIX_COUNT; stale++)
+        {
+            const std::array<uint32_t, 4> upload = stale == index ? unitedRegion(m_staleRegions[stale], region)
+                                                                 : m_staleRegions[stale];
+            uploadMatrix(texture, stale, upload);
+            m_staleRegions[stale] = {};
+        }
+        m_staleRegions[index] = region;
+        m_texture = texture;
+    }
+
+    auto calibration = std::make_shared<KWin::WarpCalibration>();
+    calibration->matrices = m_matrixTextureModel.mMatrices;
+    calibration->referencePositions = m_calibratedHeadPositions;
+    calibration->texture = m_textures[m_texture];
+    calibration->textureFormat = m_textureFormat;
+    calibration->generation = ++m_generation;
+    calibration->matrixCount = WARPING_MATRIX_COUNT;
+    calibration->resolutionX = WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X;
+    calibration->resolutionY = WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y;
+    m_pendingState.calibration = calibration;
+    // The reference positions moved, so did the pose between them. Both are published together.
+    publishPose();
+    qCInfo(KWINARHUD_DEBUG) << "SetMatrix: matrix" << index << "set, changed" << region[2] - region[0] << "x"
+                            << region[3] - region[1] << "nodes, published calibration" << m_generation;
+
+    const size_t texelBytes = m_textureFormat == GL_RG32F ? 2 * sizeof(float) : 2 * 4;
+    qCInfo(KWINARHUD_DEBUG) << "Calibration memory:" << m_matrixTextureModel.memoryBytes() / 1024.0 << "KiB of matrices,"
+                            << m_textures.size() * WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X
+                                   * WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y * WARPING_MATRIX_COUNT * texelBytes / 1024.0
+                            << "KiB of matrix textures";
+
+    if (m_effect)
+    {
+        m_effect->matricesChanged(*calibration);
+    }
+}
+
+void MBitionWarpedOutput::allocateTexture()
+{
+    // Prefer one float texel per node, the shader then skips decoding. Fall back to the encoded RGBA8 texture.
+    if (!KWin::clearGlErrors())
+    {
+        qCWarning(KWINARHUD_DEBUG) << "SetMatrix: GL errors pending, the matrix texture format check may fail";
+    }
+    m_textureFormat = GL_RG32F;
+    for (const GLuint texture : m_textures)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        auto textureData = m_matrixTextureModel.getTextureData();
-
         glTexImage2D(GL_TEXTURE_2D,
                      0,
-                     GL_RGBA8,
-                     WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X * 2,
+                     GL_RG32F,
+                     WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X,
                      WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y * WARPING_MATRIX_COUNT,
                      0,
-                     GL_RGBA,
-                     GL_UNSIGNED_BYTE,
-                     textureData.data());
-        glBindTexture(GL_TEXTURE_2D, 0);
-        qCInfo(KWINARHUD_DEBUG) << "SetMatrix: all matrices set, MBitionWarpedOutput is initialized";
+                     GL_RG,
+                     GL_FLOAT,
+                     nullptr);
     }
+
+    if (glGetError() != GL_NO_ERROR)
+    {
+        qCWarning(KWINARHUD_DEBUG) << "SetMatrix: RG32F matrix texture not supported, using RGBA8";
+        m_textureFormat = GL_RGBA8;
+        for (const GLuint texture : m_textures)
+        {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D,
+                         0,
+                         GL_RGBA8,
+                         WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X * 2,
+                         WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y * WARPING_MATRIX_COUNT,
+                         0,
+                         GL_RGBA,
+                         GL_UNSIGNED_BYTE,
+                         nullptr);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for (uint32_t texture = 0; texture < m_textures.size(); texture++)
+    {
+        for (uint32_t index = 0; index < WARPING_MATRIX_COUNT; index++)
+        {
+            uploadMatrix(texture, index, {{0, 0, WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X, WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y}});
+        }
+    }
+    m_staleRegions.assign(WARPING_MATRIX_COUNT, std::array<uint32_t, 4>{});
+}
+
+void MBitionWarpedOutput::uploadMatrix(uint32_t texture, uint32_t index, const std::array<uint32_t, 4>& region)
+{
+    const GLsizei width = static_cast<GLsizei>(region[2] - region[0]);
+    const GLsizei height = static_cast<GLsizei>(region[3] - region[1]);
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    const GLint rowOffset = static_cast<GLint>(index * WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y + region[1]);
+    const size_t firstNode = static_cast<size_t>(region[1]) * WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X + region[0];
+    glBindTexture(GL_TEXTURE_2D, m_textures[texture]);
+    if (m_textureFormat == GL_RG32F)
+    {
+        // The nodes are stored as interleaved floats, they are uploaded without staging.
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X));
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        static_cast<GLint>(region[0]),
+                        rowOffset,
+                        width,
+                        height,
+                        GL_RG,
+                        GL_FLOAT,
+                        m_matrixTextureModel.getMatrix(index).data() + firstNode * 2);
+    }
+    else
+    {
+        // Two encoded texels per node, only the rows of the region are encoded.
+        m_matrixTextureModel.getTextureData(index, region[1], region[3], m_textureData);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X * 2));
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        static_cast<GLint>(region[0] * 2),
+                        rowOffset,
+                        width * 2,
+                        height,
+                        GL_RGBA,
+                        GL_UNSIGNED_BYTE,
+                        m_textureData.data() + static_cast<size_t>(region[0]) * 2 * 4);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+KWin::WarpPose MBitionWarpedOutput::publishPose()
+{
+    KWin::WarpPose& pose = m_pendingState.pose;
+    pose.headPosition = m_headPosition;
+    m_matrixInterpolationModel.getInterpolationParameters(pose.matrixIndex, pose.matrixFactor);
+    pose.generation = m_generation;
+    m_state.publish(m_pendingState);
+    return pose;
 }
 
 void MBitionWarpedOutput::readHeadPosition(WarpingMatrixInterpolationModel::Position& destination, wl_array* input)
@@ -152,20 +364,22 @@ void MBitionWarpedOutput::readHeadPosition(WarpingMatrixInterpolationModel::Posi
     destination      = {{dataArray[0], dataArray[1], dataArray[2]}};
 }
 
-void MBitionWarpedOutput::readWarpingMatrix(Matrix& destination, wl_array* input)
+MatrixTextureModel::MatrixPointer MBitionWarpedOutput::readWarpingMatrix(wl_array* input)
 {
     size_t expectedSize = sizeof(float) * WARPING_MATRIX_INPUT_RESOLUTION_X * WARPING_MATRIX_INPUT_RESOLUTION_Y * 2;
     if (input->size != expectedSize)
     {
         qCWarning(KWINARHUD_DEBUG) << "Invalid size for warping matrices. Actual size:" << input->size
                                    << ", Expected size:" << expectedSize;
-        return;
+        return nullptr;
     }
 
     auto calibratedMatrices = static_cast<float*>(input->data);
 
     Matrix intermediate(WARPING_MATRIX_INPUT_RESOLUTION_X, WARPING_MATRIX_INPUT_RESOLUTION_Y, calibratedMatrices);
-    intermediate.getExtendedWarpingMatrix({float64_t(DISPLAY_RESOLUTION_X), float64_t(DISPLAY_RESOLUTION_Y)}, destination);
+    auto extended = std::make_shared<Matrix>(WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_X, WARPING_MATRIX_EXTRAPOLATED_RESOLUTION_Y);
+    intermediate.getExtendedWarpingMatrix({float64_t(DISPLAY_RESOLUTION_X), float64_t(DISPLAY_RESOLUTION_Y)}, *extended);
+    return extended;
 }
 
 bool MBitionWarpedOutput::isInitialized() const
@@ -9,14 +9,22 @@
 #include "WarpingMatrixInterpolationModel.hxx"
 #include "MatrixTextureModel.hxx"
 #include "WarpingUtils.hxx"
+#include "warpState.h"
 
 #include <opengl/gltexture.h>
+#include <array>
+#include <memory>
 #include <vector>
 
+namespace KWin
+{
+    class ClassicArHudEffect;
+}
+
 class MBitionWarpedOutput : public QtWaylandServer::zmbition_warped_output_v1
 {
 public:
-    MBitionWarpedOutput();
+    explicit MBitionWarpedOutput(KWin::ClassicArHudEffect* effect);
 
     /**
      * @brief Setting head position taken from ArHudDiagnosis
@@ -45,12 +53,32 @@ public:
      */
     void zmbition_warped_output_v1_destroy(Resource* resource) override;
 
+    /**
+     * @brief Latest calibration with the head pose between its matrices, called by the effect. The calibration is
+     * nullptr until every matrix was received. The state stays valid until the next call, however often the handlers
+     * publish meanwhile.
+     */
+    const KWin::WarpState& state() { return m_state.read(); }
+
 private:
     /**
      * @brief Bind a specific Warping matrix based on it's index to a GL_Texture_2D
      * @param[in] index - Specify which matrix should be bound to texture. (Upper, middle, lower)
+     * @param[in] matrix - The extrapolated matrix
+     */
+    void setMatrix(uint32_t index, MatrixTextureModel::MatrixPointer matrix);
+
+    /**
+     * @brief Allocates both matrix textures once every matrix was received and uploads all of them
+     */
+    void allocateTexture();
+
+    /**
+     * @brief Uploads a region of the matrix with the given index into the rows of the matrix texture holding it
+     * @param[in] texture - Which of the two matrix textures to write
+     * @param[in] region - Nodes to upload as {x0, y0, x1, y1}, the upper bounds exclusive
      */
-    void setMatrix(uint32_t index);
+    void uploadMatrix(uint32_t texture, uint32_t index, const std::array<uint32_t, 4>& region);
 
     /**
      * @brief Read a wayland array of floats and store them in a destination array as head positions
@@ -62,19 +90,48 @@ private:
     /**
      * @brief Read a wayland array of floats and construct an ExtendedWarpingMatrix
      * @param[in] input - Read a wayland array of floats
-     * @param[out] destination - Store converted input data in an ExtendedWarpingMatrix
+     * @return The extrapolated matrix, nullptr if the array has the wrong size
      */
-    static void readWarpingMatrix(Matrix& destination, wl_array* input);
+    static MatrixTextureModel::MatrixPointer readWarpingMatrix(wl_array* input);
+
+    /**
+     * @brief Publishes the interpolation parameters of the current head position between the calibrated matrices,
+     * together with the latest calibration.
+     * @return The published pose
+     */
+    KWin::WarpPose publishPose();
 
-public:
     bool isInitialized() const;
 
-    GLuint m_texture;
+    /**
+     * @brief Returns whether the head position and the extrapolated matrix resend the ones last applied at the index.
+     */
+    bool isResent(uint32_t index,
+                  size_t hash,
+                  const WarpingMatrixInterpolationModel::Position& headPosition,
+                  const Warping::Matrix& matrix) const;
+
+    KWin::ClassicArHudEffect* m_effect;
+
+    // Writer side state, only touched by the request handlers.
+    // The calibrations write the two textures in turn, m_texture is the one of the latest. The other one lags behind
+    // by the nodes in m_staleRegions, which are uploaded together with the next recalibration.
+    std::array<GLuint, 2> m_textures{};
+    uint32_t m_texture = 0;
+    std::vector<std::array<uint32_t, 4>> m_staleRegions;
     uint32_t m_initialized;
-    WarpingMatrixInterpolationModel::Position m_headPosition;
+    uint32_t m_generation = 0;
+    WarpingMatrixInterpolationModel::Position m_headPosition{};
     std::vector<WarpingMatrixInterpolationModel::Position> m_calibratedHeadPositions;
-    std::vector<Matrix> m_calibratedMatrices;
+    // Hash of the request payload last applied per index, valid once the index is initialized.
+    std::vector<size_t> m_payloadHashes;
     WarpingMatrixInterpolationModel m_matrixInterpolationModel;
-
     MatrixTextureModel m_matrixTextureModel;
+    // GL_NONE until every matrix was received and the texture got allocated.
+    GLenum m_textureFormat = GL_NONE;
+    // Staging of the RGBA8 uploads, reused by every upload.
+    std::vector<uint8_t> m_textureData;
+
+    KWin::WarpState m_pendingState;
+    KWin::LatestValue<KWin::WarpState> m_state;
 };
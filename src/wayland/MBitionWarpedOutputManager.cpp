@@ -5,6 +5,7 @@
 
 #include "MBitionWarpedOutput.h"
 #include "classicArHud.h"
+#include "warpingEffect.h"
 
 #include <wayland/display.h>
 #include <wayland/output.h>
@@ -32,30 +33,7 @@ void MBitionWarpedOutputManager::zmbition_warped_output_manager_v1_get_warped_ou
     }
 
     // find hud screen by its resolution
-    const auto& screens = KWin::effects->screens();
-
-    int screenIndex = 0;
-    KWin::Output* screenPtr = nullptr;
-
-    for (auto screen : screens)
-    {
-        if (screen)
-        {
-            qCInfo(KWINARHUD_DEBUG) << "Screen " << screenIndex << ": " << screen->manufacturer() << ", " << screen->model()
-                                    << ", " << screen->name() << ", " << screen->geometry();
-
-            if (uint32_t(screen->geometry().width()) == DISPLAY_RESOLUTION_X && uint32_t(screen->geometry().height()) == DISPLAY_RESOLUTION_Y)
-            {
-                screenPtr = screen;
-                break;
-            }
-        }
-        else
-        {
-            qCWarning(KWINARHUD_DEBUG) << "Printing screen infos failed: screen " << screenIndex << " is nullptr";
-        }
-        screenIndex++;
-    }
+    KWin::Output* screenPtr = KWin::WarpingEffect::findHudScreen(DISPLAY_RESOLUTION_X, DISPLAY_RESOLUTION_Y);
 
     if (screenPtr != nullptr)
     {